@@ -1,68 +1,431 @@
-#include <cbuffer.h>
+#include <errno.h>
+#include <file.h>
 #include <io.h>
 #include <list.h>
 #include <mm.h>
 #include <mm_address.h>
+#include <pollwait.h>
+#include <ring.h>
 #include <sched.h>
 #include <system.h>
+#include <termios.h>
+#include <timer.h>
 #include <uart.h>
 #include <utils.h>
 #include <devices.h>
 
-/* Interrupt uart routine */
+unsigned int uart_rx_bytes;
+unsigned int uart_rx_overruns;
+unsigned int uart_rx_fifo_overruns;
+unsigned int uart_tx_bytes;
+unsigned int uart_tx_irqs;
+unsigned int uart_tx_stalls;
+
+/* Task writing on the transmit ring, the other writers wait their turn so the
+ * bytes of a write are not mixed. The writer waits for room in uart_txqueue. */
+static struct task_struct * uart_writer;
+static LIST_HEAD(uart_writequeue);
+static LIST_HEAD(uart_txqueue);
+
+/* LINE DISCIPLINE */
+/* The interrupt edits the line (canonical mode) and moves the input that can be read
+ * to uart_read_buffer. The first reader of keyboardqueue is woken up once, when its
+ * read can be served: a whole line, VMIN bytes or the VTIME timeout. */
+
+/* Raw without echo by default, every byte wakes up the reader (as before termios) */
+static struct termios tty_termios = { 0, { 0x7f, 0x15, 0x04, 1, 0 } };
+
+static char tty_line[TTY_LINE_MAX]; /* Line being edited */
+static int tty_line_len;
+/* Lengths of the lines of uart_read_buffer (canonical), 0 is an end of file */
+static unsigned int tty_lines_arr[TTY_MAX_LINES];
+static struct ring tty_lines = RING_INIT(tty_lines_arr, sizeof(unsigned int), TTY_MAX_LINES);
+
+static struct ktimer tty_timer; /* VTIME */
+static char tty_expired;
+static struct task_struct * tty_reader; /* Reader woken up that has not read yet */
+static LIST_HEAD(tty_pollers); /* poll POLLIN on fd 0 */
+static LIST_HEAD(uart_tx_pollers); /* poll POLLOUT on fd 1 */
+
+#define tty_canonical()	(tty_termios.c_lflag & ICANON)
+
+/* Checks if the first reader, that wants 'size' bytes, can be served */
+static int tty_ready(int size) {
+	unsigned int min = tty_termios.c_cc[VMIN];
+
+	if (tty_canonical()) return !ring_empty(&tty_lines);
+
+	if (min > size) min = size;
+	if (ring_count(&uart_read_buffer) >= (min ? min : 1)) return 1;
+	if (min == 0 && tty_termios.c_cc[VTIME] == 0) return 1;
+	return tty_expired;
+}
+
+/* Wakes up the first reader if it can be served */
+static void tty_wake() {
+	struct task_struct * t;
+
+	if (tty_reader != NULL || list_empty(&keyboardqueue)) return;
+
+	t = list_head_to_task_struct(list_first(&keyboardqueue));
+	if (!tty_ready(t->kbinfo.keystoread)) return;
+
+	list_del(&t->list);
+	tty_reader = t;
+	sched_update_queues_state(&readyqueue,t);
+}
+
+static void tty_timeout(struct ktimer *t) {
+	tty_expired = 1;
+	tty_wake();
+}
+
+/* Arms VTIME (tenths of second, 1 tick == 1 ms) */
+static void tty_start_timer() {
+	tty_expired = 0;
+	ktimer_add(&tty_timer, clock_get_time() + tty_termios.c_cc[VTIME]*100 + 1);
+}
+
+/* A reader becomes the first one waiting: the VTIME of a read without VMIN starts */
+static void tty_first_waits() {
+	tty_expired = 0;
+	if (!tty_canonical() && tty_termios.c_cc[VMIN] == 0 && tty_termios.c_cc[VTIME] > 0) tty_start_timer();
+}
+
+static void tty_echo(char c) {
+	if (!(tty_termios.c_lflag & ECHO)) return;
+	if (c == '\n') uart_putc('\r');
+	uart_putc(c);
+}
+
+/* Erases the last character of the line being edited */
+static void tty_erase() {
+	if (tty_line_len == 0) return;
+	--tty_line_len;
+	tty_echo('\b');
+	tty_echo(' ');
+	tty_echo('\b');
+}
+
+/* The line being edited can be read. Dropped if there is no room for it. */
+static void tty_end_line() {
+	unsigned int len = tty_line_len;
+
+	tty_line_len = 0;
+	if (ring_full(&tty_lines) || ring_space(&uart_read_buffer) < len) {
+		uart_rx_overruns += len;
+		return;
+	}
+	ring_write_n(&uart_read_buffer, tty_line, len);
+	ring_put(&tty_lines, &len);
+}
+
+/* A byte received goes through the line discipline */
+static void tty_receive(char c) {
+	if (!tty_canonical()) {
+		if (!ring_put(&uart_read_buffer,&c)) {
+			++uart_rx_overruns;
+			return;
+		}
+		tty_echo(c);
+		/* Inter-byte timer */
+		if (tty_termios.c_cc[VMIN] > 0 && tty_termios.c_cc[VTIME] > 0) tty_start_timer();
+		return;
+	}
+
+	if (c == '\r') c = '\n';
+
+	if (c == tty_termios.c_cc[VERASE] || c == '\b') tty_erase();
+	else if (c == tty_termios.c_cc[VKILL]) {
+		while (tty_line_len > 0) tty_erase();
+	}
+	else if (c == tty_termios.c_cc[VEOF]) tty_end_line();
+	else if (c != '\n' && tty_line_len >= TTY_LINE_MAX-1) ++uart_rx_overruns; /* Room for the '\n' */
+	else {
+		tty_line[tty_line_len++] = c;
+		tty_echo(c);
+		if (c == '\n') tty_end_line();
+	}
+}
+
+/* Copies to 'dest' of task 't' up to 'size' bytes of the input, a canonical read stops
+ * at the end of the line. Returns the bytes copied or -ENACCB. */
+static int tty_read(struct task_struct *t, char *dest, int size) {
+	unsigned int * line = NULL;
+	char * seg;
+	int n, done = 0;
+
+	if (tty_canonical()) {
+		if (!ring_peek(&tty_lines, (void **)&line)) return 0;
+		/* End of file */
+		if (*line == 0) {
+			ring_commit_read(&tty_lines, 1);
+			return 0;
+		}
+	}
+
+	/* Whole contiguous segments of the buffer at once */
+	while (done < size && (n = ring_peek(&uart_read_buffer, (void **)&seg)) > 0) {
+		if (n > size - done) n = size - done;
+		if (line != NULL && n > *line) n = *line;
+		if (copy_to_task(t, seg, dest + done, n) < 0) return -ENACCB;
+		ring_commit_read(&uart_read_buffer, n);
+		done += n;
+
+		if (line != NULL) {
+			*line -= n;
+			if (*line == 0) {
+				ring_commit_read(&tty_lines, 1);
+				break;
+			}
+		}
+	}
+	return done;
+}
+
+/* Input that can be read, whatever the readers in the queue */
+static int tty_readable() {
+	return tty_canonical() ? !ring_empty(&tty_lines) : !ring_empty(&uart_read_buffer);
+}
+
+/* Readiness of the uart for poll: input to read, room in the transmit ring */
+static short uart_poll(struct file *f, short events, struct poll_table *pt) {
+	short revents = 0;
+
+	if ((events & POLLIN) && file_readable(f)) {
+		poll_wait(pt, &tty_pollers);
+		if (tty_readable()) revents |= POLLIN;
+	}
+	if ((events & POLLOUT) && file_writable(f)) {
+		poll_wait(pt, &uart_tx_pollers);
+		if (!ring_full(&uart_write_buffer)) revents |= POLLOUT;
+	}
+	return revents;
+}
+
+/* Asynchronous reads get the input only while there are no blocked 'read's */
+int tty_async_ready() {
+	if (tty_reader != NULL || !list_empty(&keyboardqueue)) return 0;
+	return tty_readable();
+}
+
+/* Asynchronous read (tty_async_ready), '*complete' is set if the request has to be
+ * completed even if it got less than 'size': a canonical read ends with the line. */
+int tty_async_read(struct task_struct *t, char *dest, int size, char *complete) {
+	int ret = tty_read(t, dest, size);
+
+	*complete = (ret < 0 || tty_canonical());
+	return ret;
+}
+
+void tty_get_termios(struct termios *t) {
+	copy_data(&tty_termios, t, sizeof(struct termios));
+}
+
+/* Changes the line discipline, the input already received is kept */
+void tty_set_termios(struct termios *t) {
+	unsigned int len;
+
+	if (tty_canonical() && !(t->c_lflag & ICANON)) {
+		/* The line being edited and the lines become a stream of bytes */
+		tty_end_line();
+		ring_commit_read(&tty_lines, ring_count(&tty_lines));
+	}
+	else if (!tty_canonical() && (t->c_lflag & ICANON) && !ring_empty(&uart_read_buffer)) {
+		/* The bytes received become a line */
+		len = ring_count(&uart_read_buffer);
+		ring_put(&tty_lines, &len);
+	}
+
+	copy_data(t, &tty_termios, sizeof(struct termios));
+	ktimer_del(&tty_timer);
+	tty_first_waits();
+	tty_wake();
+	if (!list_empty(&tty_pollers) && tty_readable()) poll_wake(&tty_pollers);
+	io_uart_drain();
+}
+
+void init_tty() {
+	init_ktimer(&tty_timer, tty_timeout, NULL);
+}
+
+/* Interrupt uart routine, empties the rx fifo */
 void interrupt_uart_routine() {
 	char data;
+	Byte lsr;
 
-	data = uart_get_byte();
+	while ((lsr = uart_line_status()) & AUX_MU_LSR_DATA_READY) {
+		/* The fifo filled up before this interrupt was served */
+		if (lsr & AUX_MU_LSR_RX_OVERRUN) ++uart_rx_fifo_overruns;
+
+		data = uart_get_byte();
+		++uart_rx_bytes;
+		tty_receive(data);
+	}
 
-	/* If the buffer is full, the data is lost */
-	circularbWrite(&uart_read_buffer,&data);
+	/* One wake up for all the bytes received */
+	tty_wake();
+	if (!list_empty(&tty_pollers) && tty_readable()) poll_wake(&tty_pollers);
+
+	/* Complete the asynchronous reads if nobody is blocked in 'read' */
+	io_uart_drain();
 }
 
-/* Uart syscall read */
+/* Uart syscall read. Blocks until the line discipline can serve it, waiting behind
+ * the readers that came before. */
 int sys_read_uart(char *buffer, int size) {
-	int i=0;
-	char read;
 	struct task_struct * current_pcb = current();
+	int ret;
 
 	current_pcb->kbinfo.keystoread = size;
 	current_pcb->kbinfo.keybuffer = buffer;
 	current_pcb->kbinfo.keysread = 0;
 
-	/* If someone else is waiting we wait */
-	if (!list_empty(&keyboardqueue)) {
-		sched_update_queues_state(&keyboardqueue,current());
+	if (tty_reader != NULL || !list_empty(&keyboardqueue) || !tty_ready(size)) {
+		if (tty_reader == NULL && list_empty(&keyboardqueue)) tty_first_waits();
+		sched_update_queues_state(&keyboardqueue,current_pcb);
 		sched_switch_process();
+		/* Woken up by tty_wake, tty_reader == current */
 	}
 
-	/* Now we are the task at the front of the queue */
-	while (current_pcb->kbinfo.keystoread > 0) {
-		if (!circularbIsEmpty(&uart_read_buffer)){
-			for (i=current_pcb->kbinfo.keystoread; i>0 && !circularbIsEmpty(&uart_read_buffer); i--) {
-				circularbRead(&uart_read_buffer,&read);
-				copy_to_user(&read, current_pcb->kbinfo.keybuffer, 1);
-				current_pcb->kbinfo.keybuffer++;
-			}
-			current_pcb->kbinfo.keysread += current_pcb->kbinfo.keystoread-i;
-			current_pcb->kbinfo.keystoread = i;
-		}
+	ret = tty_read(current_pcb, buffer, size);
+	if (ret > 0) current_pcb->kbinfo.keysread = ret;
+	tty_expired = 0;
 
-		if (current_pcb->kbinfo.keystoread > 0){
-			/* Inserted at the front of the queue */
-			sched_update_queues_state(&keyboardqueue,current());
-			sched_switch_process();
-		}
+	/* Next reader */
+	tty_reader = NULL;
+	if (!list_empty(&keyboardqueue)) {
+		tty_first_waits();
+		tty_wake();
+	}
+	else ktimer_del(&tty_timer);
+	io_uart_drain();
+
+	return ret;
+}
+
+/* Moves bytes of the transmit ring to the uart fifo while it has room. The tx
+ * interrupt is kept enabled only while there are bytes left. */
+static void uart_tx_drain() {
+	char c;
+
+	while (uart_tx_ready() && ring_get(&uart_write_buffer,&c)) {
+		uart_put_byte(c);
+		++uart_tx_bytes;
 	}
+	uart_toggle_tx_interrupt(!ring_empty(&uart_write_buffer));
+}
+
+/* Interrupt uart tx routine, the fifo has room */
+void interrupt_uart_tx_routine() {
+	struct list_head * task_list;
+
+	++uart_tx_irqs;
+	uart_tx_drain();
+
+	/* Wake up the writer once half of the ring is free */
+	if (!list_empty(&uart_txqueue) && ring_count(&uart_write_buffer) <= UART_WRITE_BUFFER_SIZE/2) {
+		task_list = list_first(&uart_txqueue);
+		list_del(task_list);
+		sched_update_queues_state(&readyqueue,list_head_to_task_struct(task_list));
+	}
+	if (!list_empty(&uart_tx_pollers) && ring_count(&uart_write_buffer) <= UART_WRITE_BUFFER_SIZE/2) poll_wake(&uart_tx_pollers);
+}
+
+/* Queues a byte of the kernel (printk). Never blocks: with the ring full it
+ * polls the uart, the interrupts may be disabled. The ring has a single producer
+ * at a time because printk and the writers run with the interrupts disabled. */
+void uart_putc(char c) {
+	unsigned int cpsr = read_cpsr();
 
-	return current_pcb->kbinfo.keysread;
+	__asm__ __volatile__ ("cpsid i;");
+	while (!ring_put(&uart_write_buffer,&c)) uart_tx_drain();
+	uart_tx_drain();
+	write_cpsr(cpsr);
 }
 
-/* Uart syscall write */
+/* Uart syscall write. Copies the buffer (of the current address space) straight
+ * to the transmit ring and blocks only while the ring is full. The ring and the
+ * queues are shared with the uart interrupt, the kernel threads (io_ring) may call
+ * it with the interrupts enabled. */
 int sys_write_uart(char *buffer,int size) {
-	int i;
+	struct list_head * task_list;
+	struct task_struct * current_pcb = current();
+	unsigned int cpsr = read_cpsr();
+	int written = 0;
+
+	__asm__ __volatile__ ("cpsid i;");
+
+	/* Wait for the turn, given by the previous writer */
+	if (uart_writer != NULL) {
+		sched_update_queues_state(&uart_writequeue,current_pcb);
+		sched_switch_process();
+	}
+	uart_writer = current_pcb;
+
+	while (1) {
+		written += ring_write_n(&uart_write_buffer, buffer+written, size-written);
+		uart_tx_drain();
+		if (written == size) break;
+
+		++uart_tx_stalls;
+		sched_update_queues_state(&uart_txqueue,current_pcb);
+		sched_switch_process();
+	}
+
+	/* Pass the turn */
+	uart_writer = NULL;
+	if (!list_empty(&uart_writequeue)) {
+		task_list = list_first(&uart_writequeue);
+		list_del(task_list);
+		uart_writer = list_head_to_task_struct(task_list);
+		sched_update_queues_state(&readyqueue,uart_writer);
+	}
+
+	write_cpsr(cpsr);
+	return size;
+}
 
-	for (i=0; i<size; i++) printc(buffer[i]);
 
+/* FILE OPERATIONS */
+
+static int uart_file_read(struct file *f, char *buffer, int size) {
+	return sys_read_uart(buffer,size);
+}
+
+static int uart_file_write(struct file *f, char *buffer, int size) {
+	return sys_write_uart(buffer,size);
+}
+
+struct file_operations uart_fops = {
+	.read = uart_file_read,
+	.write = uart_file_write,
+	.poll = uart_poll,
+};
+
+/* /dev/null: end of file on read, discards the writes */
+static int null_read(struct file *f, char *buffer, int size) {
+	return 0;
+}
+
+static int null_write(struct file *f, char *buffer, int size) {
+	return size;
+}
+
+struct file_operations null_fops = {
+	.read = null_read,
+	.write = null_write,
+};
+
+/* /dev/zero: reads zeros, discards the writes */
+static int zero_read(struct file *f, char *buffer, int size) {
+	int i;
+
+	for (i = 0; i < size; i++) buffer[i] = 0;
 	return size;
 }
 
+struct file_operations zero_fops = {
+	.read = zero_read,
+	.write = null_write,
+};
@@ -0,0 +1,191 @@
+#include <file.h>
+#include <devices.h>
+#include <errno.h>
+#include <ramfs.h>
+#include <sched.h>
+#include <utils.h>
+
+/* Open files of the system */
+static struct file file_table[NR_FILES];
+
+/* Devices that can be opened, "/dev/<name>". The other paths are files of the ramfs. */
+struct device {
+	char * name;
+	struct file_operations * ops;
+};
+
+static struct device device_table[] = {
+	{ "tty", &uart_fops },
+	{ "null", &null_fops },
+	{ "zero", &zero_fops },
+};
+
+#define NR_DEVICES	(sizeof(device_table)/sizeof(struct device))
+#define DEV_PREFIX	"/dev/"
+
+static int str_equal(char *a, char *b) {
+	while (*a && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+/* Open file of the descriptor 'fd' of 't', NULL if it is not open */
+struct file * file_get(struct task_struct *t, int fd) {
+	if (fd < 0 || fd >= NR_OPEN) return NULL;
+	return t->fds[fd];
+}
+
+/* New open file, count == 1. NULL if the table is full. */
+struct file * file_alloc(struct file_operations *ops, int mode) {
+	int i;
+
+	for (i = 0; i < NR_FILES; i++) {
+		if (file_table[i].count == 0) {
+			file_table[i].ops = ops;
+			file_table[i].mode = mode;
+			file_table[i].count = 1;
+			file_table[i].pos = 0;
+			file_table[i].private_data = NULL;
+			return &file_table[i];
+		}
+	}
+	return NULL;
+}
+
+/* Drops a reference, the last one releases the file */
+static void file_put(struct file *f) {
+	if (--(f->count) > 0) return;
+	if (f->ops->release) f->ops->release(f);
+}
+
+/* Lowest free descriptor of 't', -EMFILE if there is none */
+int fd_alloc(struct task_struct *t) {
+	int fd;
+
+	for (fd = 0; fd < NR_OPEN; fd++) {
+		if (t->fds[fd] == NULL) return fd;
+	}
+	return -EMFILE;
+}
+
+/* Copies a path of the user, -EINVAL if it is too long */
+static int copy_path(char *upath, char *path) {
+	int i;
+
+	for (i = 0; i < PATH_MAX; i++) {
+		if (access_ok(VERIFY_READ, upath+i, 1) == 0) return -ENACCB;
+		copy_from_user(upath+i, path+i, 1);
+		if (path[i] == '\0') return 0;
+	}
+	return -EINVAL;
+}
+
+/* A new task has no open files */
+void files_init(struct task_struct *t) {
+	int fd;
+
+	for (fd = 0; fd < NR_OPEN; fd++) t->fds[fd] = NULL;
+}
+
+/* The descriptors copied to a new task (fork, clone) share the open files */
+void files_dup(struct task_struct *t) {
+	int fd;
+
+	for (fd = 0; fd < NR_OPEN; fd++) {
+		if (t->fds[fd] != NULL) ++(t->fds[fd]->count);
+	}
+}
+
+/* Closes all the descriptors of an exiting task */
+void files_close(struct task_struct *t) {
+	int fd;
+
+	for (fd = 0; fd < NR_OPEN; fd++) {
+		if (t->fds[fd] != NULL) file_put(t->fds[fd]);
+		t->fds[fd] = NULL;
+	}
+}
+
+/* Descriptors 0 (read) and 1 (write) on the uart, for the first task */
+int open_console(struct task_struct *t) {
+	files_init(t);
+	t->fds[0] = file_alloc(&uart_fops, O_RDONLY);
+	t->fds[1] = file_alloc(&uart_fops, O_WRONLY);
+	if (t->fds[0] == NULL || t->fds[1] == NULL) return -ENFILE;
+	return 0;
+}
+
+/* Syscall open, returns the lowest free descriptor */
+int sys_open(char *upath, int flags) {
+	struct task_struct * current_pcb = current();
+	char path[PATH_MAX];
+	struct file_operations * ops = NULL;
+	struct file * f;
+	int fd, i, dev, ret;
+
+	if (upath == NULL) return -EPNULL;
+	if ((flags & O_ACCMODE) == O_ACCMODE || (flags & ~(O_ACCMODE|O_CREAT))) return -EINVAL;
+	ret = copy_path(upath, path);
+	if (ret < 0) return ret;
+
+	for (i = 0; DEV_PREFIX[i] != '\0' && path[i] == DEV_PREFIX[i]; i++);
+	if (DEV_PREFIX[i] == '\0') {
+		for (dev = 0; dev < NR_DEVICES; dev++) {
+			if (str_equal(&path[i], device_table[dev].name)) ops = device_table[dev].ops;
+		}
+		if (ops == NULL) return -ENOENT;
+	}
+	else ops = &ramfs_fops;
+
+	fd = fd_alloc(current_pcb);
+	if (fd < 0) return fd;
+	f = file_alloc(ops, flags & O_ACCMODE);
+	if (f == NULL) return -ENFILE;
+	if (ops->open) {
+		ret = ops->open(f, path, flags);
+		if (ret < 0) {
+			f->count = 0; /* Back to the free entries, it was never opened */
+			return ret;
+		}
+	}
+
+	current_pcb->fds[fd] = f;
+	return fd;
+}
+
+/* Syscall close */
+int sys_close(int fd) {
+	struct task_struct * current_pcb = current();
+	struct file * f = file_get(current_pcb, fd);
+
+	if (f == NULL) return -EBADF;
+	current_pcb->fds[fd] = NULL;
+	file_put(f);
+	return 0;
+}
+
+/* Syscall dup, the lowest free descriptor shares the open file of 'fd' */
+int sys_dup(int fd) {
+	struct task_struct * current_pcb = current();
+	struct file * f = file_get(current_pcb, fd);
+	int new_fd;
+
+	if (f == NULL) return -EBADF;
+	new_fd = fd_alloc(current_pcb);
+	if (new_fd < 0) return new_fd;
+
+	++(f->count);
+	current_pcb->fds[new_fd] = f;
+	return new_fd;
+}
+
+/* Syscall lseek, returns the new offset. -ESPIPE on the devices. */
+int sys_lseek(int fd, int offset, int whence) {
+	struct file * f = file_get(current(), fd);
+
+	if (f == NULL) return -EBADF;
+	if (f->ops->lseek == NULL) return -ESPIPE;
+	return f->ops->lseek(f, offset, whence);
+}
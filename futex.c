@@ -0,0 +1,66 @@
+#include <futex.h>
+#include <devices.h>
+#include <errno.h>
+#include <list.h>
+#include <mm.h>
+#include <sched.h>
+
+#define FUTEX_HASH_SIZE	16	/* A power of two */
+
+/* Tasks blocked in FUTEX_WAIT, hashed by the physical address of the futex. The key
+ * is the same for the threads of a process and for processes sharing the frame. */
+static struct list_head futex_queues[FUTEX_HASH_SIZE];
+
+static struct list_head * futex_hash(unsigned int key) {
+	return &futex_queues[((key >> 2) ^ (key >> OFFSET_BITS)) & (FUTEX_HASH_SIZE-1)];
+}
+
+/* Physical address of the user word 'uaddr', 0 if it is not a mapped aligned word */
+static unsigned int futex_key(int *uaddr) {
+	sl_page_table_entry * pt = get_PT(current(),1);
+	unsigned int addr = (unsigned int)uaddr;
+
+	if ((addr & 3) != 0 || DIR(addr) != 1) return 0;
+	if (!check_used_page(&pt[PAGE(addr)])) return 0;
+	return (get_frame(pt, PAGE(addr)) << OFFSET_BITS) | OFFSET(addr);
+}
+
+/* Syscall futex. FUTEX_WAIT blocks if '*uaddr' still is 'val' (-EAGAIN otherwise),
+ * the check and the sleep are atomic (the kernel is not preemptive). FUTEX_WAKE
+ * returns the number of tasks woken up. */
+int sys_futex(int *uaddr, int op, int val) {
+	struct task_struct * t;
+	struct list_head * pos, * n, * queue;
+	unsigned int key = futex_key(uaddr);
+	int woken = 0;
+
+	if (key == 0) return -EINVAL;
+	queue = futex_hash(key);
+
+	switch (op) {
+		case FUTEX_WAIT:
+			if (*uaddr != val) return -EAGAIN;
+			current()->futex_key = key;
+			sched_update_queues_state(queue, current());
+			sched_switch_process();
+			return 0;
+		case FUTEX_WAKE:
+			list_for_each_safe(pos, n, queue) {
+				if (woken >= val) break;
+				t = list_head_to_task_struct(pos);
+				if (t->futex_key != key) continue;
+				list_del(pos);
+				sched_update_queues_state(&readyqueue, t);
+				++woken;
+			}
+			return woken;
+		default:
+			return -EINVAL;
+	}
+}
+
+void init_futex() {
+	int i;
+
+	for (i = 0; i < FUTEX_HASH_SIZE; i++) INIT_LIST_HEAD(&futex_queues[i]);
+}
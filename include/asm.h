@@ -1,6 +1,9 @@
 #ifndef __ASM_H__
 #define __ASM_H__
 
+/* offsetof(struct task_struct, user_lr), the entry stubs save the user sp/lr there */
+#define TASK_USER_LR	0x1C
+
 #define ENTRY(name) \
   .globl name; \
   .type name, function; \
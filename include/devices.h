@@ -2,10 +2,37 @@
 #define	__DEVICES_H__
 
 #include <types.h>
+#include <file.h>
+#include <sched.h>
+#include <termios.h>
+
+extern struct file_operations uart_fops;
+extern struct file_operations null_fops;
+extern struct file_operations zero_fops;
+
+extern unsigned int uart_rx_bytes;
+extern unsigned int uart_rx_overruns;
+extern unsigned int uart_rx_fifo_overruns;
+extern unsigned int uart_tx_bytes;
+extern unsigned int uart_tx_irqs;
+extern unsigned int uart_tx_stalls;
 
 void interrupt_uart_routine();
+void init_tty();
+void tty_get_termios(struct termios *t);
+void tty_set_termios(struct termios *t);
+int tty_async_ready();
+int tty_async_read(struct task_struct *t, char *dest, int size, char *complete);
+void interrupt_uart_tx_routine();
+void uart_putc(char c);
 
 int sys_write_uart(char *buffer, int size);
 int sys_read_uart(char *buffer, int size);
 
+/* Asynchronous I/O rings */
+void init_ioring();
+void init_futex();
+void io_uart_drain();
+void io_release(struct task_struct *t);
+
 #endif /* __DEVICES_H__*/
@@ -20,6 +20,17 @@ extern int errno;
 #define ESNOWN 15 /* Not the owner of the semaphore */
 #define ENOMEM 16 /* Not enough free memory in the heap */
 #define EHLIMI 17 /* Heap limit reached */
+#define EINVAL 18 /* Invalid argument */
+#define ENOSCH 19 /* Real-time task set would not be schedulable */
+#define ENOENT 20 /* No such file or device */
+#define EMFILE 21 /* Too many open files in the task */
+#define ENFILE 22 /* Too many open files in the system */
+#define ESPIPE 23 /* Illegal seek */
+#define EFBIG 24 /* File too large */
+#define ENOSPC 25 /* No space left on the filesystem */
+#define EPIPE 26 /* Broken pipe */
+#define EEXIST 27 /* Already exists */
+#define EAGAIN 28 /* Try again */
 
 #endif
 
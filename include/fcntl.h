@@ -0,0 +1,16 @@
+#ifndef __FCNTL_H__
+#define __FCNTL_H__
+
+/* 'open' flags */
+#define O_RDONLY	0
+#define O_WRONLY	1
+#define O_RDWR		2
+#define O_ACCMODE	3
+#define O_CREAT		0x40	/* Creates a ramfs file that does not exist */
+
+/* 'lseek' origins */
+#define SEEK_SET	0
+#define SEEK_CUR	1
+#define SEEK_END	2
+
+#endif /* __FCNTL_H__ */
@@ -0,0 +1,47 @@
+#ifndef __FILE_H__
+#define __FILE_H__
+
+#include <fcntl.h>
+#include <list.h>
+
+#define NR_OPEN		8	/* File descriptors of a task */
+#define NR_FILES	32	/* Open files of the system */
+#define PATH_MAX	32
+
+struct file;
+struct poll_table;
+struct task_struct;
+
+/* Operations of a device, NULL 'poll' is always ready. 'open' gets the name of the
+ * file, 'mmap' returns the frame of the page 'pgoff' of the file. */
+struct file_operations {
+	int (*open)(struct file *f, char *name, int flags);
+	int (*read)(struct file *f, char *buffer, int size);
+	int (*write)(struct file *f, char *buffer, int size);
+	short (*poll)(struct file *f, short events, struct poll_table *pt);
+	void (*release)(struct file *f);
+	int (*lseek)(struct file *f, int offset, int whence);
+	int (*mmap)(struct file *f, unsigned int pgoff);
+};
+
+/* Open file, shared by the descriptors dup'ed or inherited from it */
+struct file {
+	struct file_operations * ops;
+	int mode; /* O_RDONLY, O_WRONLY or O_RDWR */
+	int count; /* Descriptors pointing to it, 0 if the entry is free */
+	unsigned int pos; /* Offset of the next read/write (ramfs) */
+	void * private_data;
+};
+
+#define file_readable(f)	(((f)->mode & O_ACCMODE) != O_WRONLY)
+#define file_writable(f)	(((f)->mode & O_ACCMODE) != O_RDONLY)
+
+struct file * file_get(struct task_struct *t, int fd);
+struct file * file_alloc(struct file_operations *ops, int mode);
+int fd_alloc(struct task_struct *t);
+void files_init(struct task_struct *t);
+void files_dup(struct task_struct *t);
+void files_close(struct task_struct *t);
+int open_console(struct task_struct *t);
+
+#endif /* __FILE_H__ */
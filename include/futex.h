@@ -0,0 +1,22 @@
+#ifndef __FUTEX_H__
+#define __FUTEX_H__
+
+/* 'futex' operations */
+#define FUTEX_WAIT	0	/* Blocks if *uaddr == val */
+#define FUTEX_WAKE	1	/* Wakes up to val tasks blocked on uaddr */
+
+/* Mutex of libc: 0 unlocked, 1 locked, 2 locked with waiters. It can be shared by
+ * threads (clone) or by processes (in a shm region). */
+struct mutex {
+	volatile int val;
+};
+
+#define MUTEX_INIT	{ 0 }
+
+/* Counting semaphore of libc, only 'usem_wait' with value 0 enters the kernel */
+struct usem {
+	volatile int value;
+	volatile int waiters;
+};
+
+#endif /* __FUTEX_H__ */
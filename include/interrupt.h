@@ -59,7 +59,7 @@ void ret_from_fork();
 void ret_from_clone();
 
 void reset_routine();
-void undefined_instruction_routine();
+void undefined_instruction_routine(unsigned int instr);
 void prefetch_abort_routine();
 void data_abort_routine();
 void interrupt_request_routine();
@@ -0,0 +1,51 @@
+#ifndef __IORING_H__
+#define __IORING_H__
+
+/* Asynchronous I/O rings, a page shared between a task and the kernel (io_setup).
+ * The task fills SQEs and moves sq_tail, the kernel consumes them on io_enter and
+ * posts a CQE per request moving cq_tail, the task consumes CQEs moving cq_head.
+ * Indices are free-running, the slot is the index modulo the number of entries. */
+#define IORING_ENTRIES		32	/* Submission entries, also max requests in flight */
+#define IORING_CQ_ENTRIES	(2*IORING_ENTRIES)
+
+/* Opcodes */
+#define IORING_OP_NOP		0
+#define IORING_OP_READ		1	/* Read 'len' bytes of the fd into 'buf' (fd 0) */
+#define IORING_OP_WRITE		2	/* Write 'len' bytes of 'buf' to the fd (fd 1) */
+
+/* Submission entry, filled by the task */
+struct io_sqe {
+	unsigned int opcode;
+	int fd;
+	char * buf;
+	int len;
+	unsigned int user_data; /* Copied to the completion */
+};
+
+/* Completion entry, filled by the kernel */
+struct io_cqe {
+	unsigned int user_data;
+	int res; /* Bytes transferred or -errno */
+};
+
+struct io_ring {
+	volatile unsigned int sq_head; /* Written by the kernel */
+	volatile unsigned int sq_tail; /* Written by the task */
+	volatile unsigned int cq_head; /* Written by the task */
+	volatile unsigned int cq_tail; /* Written by the kernel */
+	volatile unsigned int cq_overflow; /* Completions lost because the CQ was full */
+	struct io_sqe sqes[IORING_ENTRIES];
+	struct io_cqe cqes[IORING_CQ_ENTRIES];
+};
+
+/* Next free SQE, NULL if the SQ is full. Submitted by 'ioring_sq_push'. */
+#define ioring_get_sqe(r) \
+	((r)->sq_tail - (r)->sq_head < IORING_ENTRIES ? &(r)->sqes[(r)->sq_tail % IORING_ENTRIES] : (struct io_sqe *)0)
+#define ioring_sq_push(r)	((r)->sq_tail++)
+
+/* Oldest completion not consumed, NULL if there is none. Consumed by 'ioring_cq_pop'. */
+#define ioring_peek_cqe(r) \
+	((r)->cq_head != (r)->cq_tail ? &(r)->cqes[(r)->cq_head % IORING_CQ_ENTRIES] : (struct io_cqe *)0)
+#define ioring_cq_pop(r)	((r)->cq_head++)
+
+#endif /* __IORING_H__ */
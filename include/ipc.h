@@ -0,0 +1,11 @@
+#ifndef __IPC_H__
+#define __IPC_H__
+
+#define IPC_WORDS	4
+
+/* Message of 'ipc_call' / 'ipc_reply_wait', copied through the task_struct */
+struct ipc_msg {
+	unsigned int w[IPC_WORDS];
+};
+
+#endif /* __IPC_H__ */
@@ -1,7 +1,15 @@
 #ifndef __LIBC_H__
 #define __LIBC_H__
 
+#include <fcntl.h>
+#include <futex.h>
+#include <ipc.h>
+#include <ioring.h>
+#include <mman.h>
+#include <shm.h>
+#include <poll.h>
 #include <stats.h>
+#include <termios.h>
 
 void itoa(int a, char *b);
 int strlen(char *a);
@@ -9,11 +17,15 @@ int strlen(char *a);
 int write(int fd, char *buffer, int size);
 int read (int fd, char *buffer, int size);
 unsigned int gettime();
+unsigned int gettime_us();
 int getpid();
 int fork();
 int debug_task_switch();
 void exit();
 int get_stats(int pid, struct stats *st);
+int get_sys_stats(struct sys_stats *st);
+int get_stats_v(int pid, unsigned int version, void *st);
+int get_work_stats(int id, struct work_stats *st);
 int clone (void (*function)(void), void *stack);
 int sem_init (int n_sem, unsigned int value);
 int sem_wait (int n_sem);
@@ -21,5 +33,37 @@ int sem_signal (int n_sem);
 int sem_destroy (int n_sem);
 void *sbrk (int increment);
 void change_led(int status);
+int set_priority(int pid, int prio);
+int set_nice(int pid, int nice);
+int set_deadline(unsigned int period, unsigned int runtime, unsigned int deadline);
+int wait_period();
+int sleep_ms(unsigned int ms);
+int sleep_until(unsigned int deadline);
+struct io_ring *io_setup();
+int io_enter(unsigned int to_submit, unsigned int min_complete);
+int tcgetattr(int fd, struct termios *t);
+int tcsetattr(int fd, int actions, struct termios *t);
+int poll(struct pollfd *fds, unsigned int nfds, int timeout);
+int open(const char *path, int flags);
+int close(int fd);
+int dup(int fd);
+int lseek(int fd, int offset, int whence);
+void *mmap(unsigned int length, int prot, int fd, unsigned int offset);
+int munmap(void *addr, unsigned int length);
+int pipe(int fds[2]);
+int shm_create(int id, unsigned int size);
+void *shm_attach(int id);
+int shm_detach(void *addr);
+int shm_remove(int id);
+int futex(int *uaddr, int op, int val);
+void mutex_init(struct mutex *m);
+void mutex_lock(struct mutex *m);
+int mutex_trylock(struct mutex *m);
+void mutex_unlock(struct mutex *m);
+void usem_init(struct usem *s, int value);
+void usem_wait(struct usem *s);
+void usem_post(struct usem *s);
+int ipc_call(int pid, struct ipc_msg *msg);
+int ipc_reply_wait(int reply_pid, struct ipc_msg *msg);
 
 #endif  /* __LIBC_H__ */
@@ -8,12 +8,21 @@
 #define FREE_FRAME 0
 #define USED_FRAME 1
 
-/* Bytemap to mark the free physical pages */
+#define CACHE_LINE_SIZE 32
+
+#define ASID_BITS 8
+#define ASID_MASK ((1<<ASID_BITS)-1)
+
+/* References to each physical page (page table entries, owners), FREE_FRAME if it is free */
 extern Byte phys_mem[TOTAL_PH_PAGES];
 
+extern unsigned int tlb_flushes_avoided;
+extern unsigned int asid_rollovers;
+
 int init_frames();
 int alloc_frame();
 void free_frame( unsigned int frame );
+void ref_frame( unsigned int frame );
 
 void init_mm();
 void init_dir_pages();
@@ -23,16 +32,40 @@ void set_coprocessor_reg_MMU();
 
 void set_user_pages( struct task_struct *task );
 void mmu_change_dir (fl_page_table_entry * dir);
+void mmu_switch_dir (fl_page_table_entry * dir);
+void mmu_flush_tlb (fl_page_table_entry * dir);
+
+void dcache_clean_range(void *start, unsigned int size);
+void dcache_clean_invalidate();
+void icache_invalidate();
+void mmu_clean_pte(sl_page_table_entry * pte);
+void sync_code_range(void *start, unsigned int size);
+
+void init_asid();
+int dir_index (fl_page_table_entry * dir);
+unsigned int dir_get_asid (int i);
 
 void enable_icache();
 void disable_icache();
 
 char check_used_page(sl_page_table_entry *pt);
 void set_ss_pag(sl_page_table_entry *PT, unsigned page,unsigned frame);
+void set_ss_pag_ro(sl_page_table_entry *PT, unsigned page,unsigned frame);
 void del_ss_pag(sl_page_table_entry *PT, unsigned page);
 unsigned int get_frame(sl_page_table_entry *PT, unsigned int page);
+int mmap_region_alloc(sl_page_table_entry *PT, unsigned int npages);
+
+void * kmap(unsigned int frame);
+int copy_to_task(struct task_struct *task, void *start, void *dest, int size);
+int copy_from_task(struct task_struct *task, void *start, void *dest, int size);
 
 void set_vitual_to_phsycial(unsigned int virtual, unsigned ph, char to_current_task);
+void set_user_ro_page(unsigned int virtual, unsigned int ph, char device);
+
+/* Shared memory regions of an address space (shm.c) */
+void init_shm();
+void shm_fork(struct task_struct *parent, struct task_struct *child);
+void shm_release(struct task_struct *t);
 
 /* Clone/heap related functions */
 void allocate_page_dir (struct task_struct *p);
@@ -33,15 +33,23 @@
 
 /* Peripherals/Structure definitions */
 #define UART_READ_BUFFER_SIZE 	1024
+#define UART_WRITE_BUFFER_SIZE 	1024
+#define TTY_LINE_MAX			256	/* Line being edited (canonical mode) */
+#define TTY_MAX_LINES			16	/* Lines received and not read yet */
 #define SEM_SIZE 				30
 #define HEAPSTART_OLD			(NUM_PAG_KERNEL+NUM_PAG_CODE+NUM_PAG_DATA)
 #define USR_P_HEAPSTART 		(NUM_PAG_CODE+NUM_PAG_DATA)
+#define NUM_PAG_IORING			10	/* One I/O ring page per task (NR_TASKS) at the top of the user space */
+#define IORING_FIRST_PAG_D1		(TOTAL_PAGES_ENTRIES-NUM_PAG_IORING)
+#define NUM_PAG_MMAP			32	/* File mappings, between the heap and the I/O rings */
+#define MMAP_FIRST_PAG_D1		(IORING_FIRST_PAG_D1-NUM_PAG_MMAP)
 
 /* Memory distribution */
 /***********************/
 #define KERNEL_START			0x10000
 #define L_USER_START			0x100000
 #define PH_USER_START			0x100000
+#define KMAP_ADDR				0xFD000	/* Kernel window to reach the frames of other tasks */
 #define USER_SP					L_USER_START+(NUM_PAG_CODE+NUM_PAG_DATA)*0x1000-0x10 //0x11BFF0
 #define DIR(x)					(((x)>>(PAGE_BITS+OFFSET_BITS))&(TOTAL_DIR_ENTRIES-1))
 #define PAGE(x)					(((x)>>OFFSET_BITS)&(TOTAL_PAGES_ENTRIES-1))
@@ -0,0 +1,10 @@
+#ifndef __MMAN_H__
+#define __MMAN_H__
+
+/* 'mmap' protections, the mappings are always shared with the file */
+#define PROT_READ	0x1
+#define PROT_WRITE	0x2
+
+#define MAP_FAILED	((void *)-1)
+
+#endif /* __MMAN_H__ */
@@ -0,0 +1,34 @@
+#ifndef __PIPE_H__
+#define __PIPE_H__
+
+#include <file.h>
+#include <list.h>
+#include <mm_address.h>
+
+#define NR_PIPES	8
+#define PIPE_PAGES	4	/* Frames of the ring of a pipe, a power of two */
+#define PIPE_SIZE	(PIPE_PAGES*PAGE_SIZE)
+
+/* Ring of whole frames, 'head' and 'tail' count the bytes written and read.
+ * The pipe is free when both ends are closed. */
+struct pipe {
+	unsigned int frames[PIPE_PAGES];
+	unsigned int head;
+	unsigned int tail;
+	int readers; /* Open read end */
+	int writers; /* Open write end */
+	struct list_head readqueue;
+	struct list_head writequeue;
+	struct list_head pollers;
+};
+
+extern struct file_operations pipe_fops;
+
+extern unsigned int pipe_bytes;
+extern unsigned int pipe_pages_moved;
+extern unsigned int pipe_read_blocks;
+extern unsigned int pipe_write_blocks;
+
+void init_pipes();
+
+#endif /* __PIPE_H__ */
@@ -0,0 +1,20 @@
+#ifndef __POLL_H__
+#define __POLL_H__
+
+/* Readiness sources of 'poll': the uart (fd 0 readable, fd 1 writable) and the semaphores */
+#define POLL_MAX		16	/* Sources per call */
+#define POLL_SEM_BASE	0x100
+#define POLL_SEM(n)		(POLL_SEM_BASE+(n))	/* "fd" of the semaphore n, POLLIN if sem_wait would not block */
+
+/* events/revents */
+#define POLLIN		0x1
+#define POLLOUT		0x4
+#define POLLNVAL	0x20	/* revents only: invalid fd or semaphore not initialised (or destroyed) */
+
+struct pollfd {
+	int fd;
+	short events;
+	short revents;
+};
+
+#endif /* __POLL_H__ */
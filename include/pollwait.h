@@ -0,0 +1,43 @@
+#ifndef __POLLWAIT_H__
+#define __POLLWAIT_H__
+
+#include <file.h>
+#include <list.h>
+#include <poll.h>
+#include <sched.h>
+#include <timer.h>
+
+/* A task blocked in 'poll' */
+struct poll_frame {
+	struct task_struct * task;
+	char woken;
+	char timed_out;
+	struct ktimer timer;
+};
+
+/* Entry of a poll_frame in the waiter list of a source. The source that becomes ready
+ * marks its entries, the task only checks those pollfds ('index') again. */
+struct poll_entry {
+	struct list_head list;
+	struct poll_frame * frame;
+	short index;
+	char fired;
+};
+
+#define POLL_ENTRIES	(2*POLL_MAX)	/* A pollfd can wait on two lists (POLLIN|POLLOUT) */
+
+/* Passed to the poll operations, that register their waiter lists with poll_wait */
+struct poll_table {
+	struct poll_frame * frame; /* NULL if the caller does not block */
+	struct poll_entry * entries;
+	short index; /* pollfd being checked */
+	short n;
+};
+
+void poll_wait(struct poll_table *pt, struct list_head *wq);
+void poll_wake(struct list_head *pollers);
+
+/* Readiness of a semaphore, returns the revents of 'events' */
+short sem_poll(int n_sem, short events, struct poll_table *pt);
+
+#endif /* __POLLWAIT_H__ */
@@ -0,0 +1,23 @@
+#ifndef __RAMFS_H__
+#define __RAMFS_H__
+
+#include <file.h>
+#include <mm_address.h>
+
+#define RAMFS_FILES		16	/* Files of the filesystem */
+#define RAMFS_FILE_PAGES	16	/* Frames of a file, 64KB at most */
+#define RAMFS_MAX_SIZE		(RAMFS_FILE_PAGES*PAGE_SIZE)
+
+/* A file of the ramfs, its data lives in frames of alloc_frame (0 is a hole) */
+struct ramfs_inode {
+	char name[PATH_MAX];
+	int used;
+	unsigned int size;
+	unsigned int frames[RAMFS_FILE_PAGES];
+};
+
+extern struct file_operations ramfs_fops;
+
+void init_ramfs();
+
+#endif /* __RAMFS_H__ */
@@ -0,0 +1,65 @@
+#ifndef __RBTREE_H__
+#define __RBTREE_H__
+
+/*
+ * Red-black tree, intrusive like list.h: the rb_node is embedded in the
+ * structure that is sorted. The caller walks down the tree to find the
+ * insertion point, links the node with rb_link_node() and then rebalances
+ * with rb_insert_color().
+ */
+
+#define RB_RED		0
+#define RB_BLACK	1
+
+struct rb_node {
+	struct rb_node *parent, *left, *right;
+	int color;
+};
+
+struct rb_root {
+	struct rb_node *node;
+};
+
+#define RB_ROOT_INIT	{ (struct rb_node *) 0 }
+
+/**
+ * rb_entry - get the struct for this entry
+ * @ptr:	the &struct rb_node pointer.
+ * @type:	the type of the struct this is embedded in.
+ * @member:	the name of the rb_node within the struct.
+ */
+#define rb_entry(ptr, type, member) \
+            ((type *)((char *)(ptr)-(unsigned long)(&((type *)0)->member)))
+
+static inline void INIT_RB_ROOT(struct rb_root *root)
+{
+	root->node = (struct rb_node *) 0;
+}
+
+static inline int rb_empty(const struct rb_root *root)
+{
+	return root->node == (struct rb_node *) 0;
+}
+
+/**
+ * rb_link_node - links a new node as a leaf of the tree
+ * @node:	the node to insert.
+ * @parent:	the leaf that will become its parent (NULL for an empty tree).
+ * @link:	the child pointer of @parent (or the root) where it goes.
+ */
+static inline void rb_link_node(struct rb_node *node, struct rb_node *parent,
+				struct rb_node **link)
+{
+	node->parent = parent;
+	node->left = node->right = (struct rb_node *) 0;
+	node->color = RB_RED;
+	*link = node;
+}
+
+void rb_insert_color(struct rb_node *node, struct rb_root *root);
+void rb_erase(struct rb_node *node, struct rb_root *root);
+
+struct rb_node *rb_first(const struct rb_root *root);
+struct rb_node *rb_next(const struct rb_node *node);
+
+#endif /* __RBTREE_H__ */
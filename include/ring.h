@@ -0,0 +1,130 @@
+#ifndef __RING_H__
+#define __RING_H__
+
+/* Single-producer/single-consumer ring of 'size' (power of two) elements of 'esize' bytes.
+ * 'head' and 'tail' are free-running, only the producer writes 'head' and only the
+ * consumer writes 'tail', so one side can be an interrupt handler and the other a task
+ * without disabling the interrupts. Several producers (or consumers) must serialize
+ * among themselves. Also used by the host benchmark (ring_bench.c). */
+struct ring {
+	volatile unsigned int head; /* Next element to write */
+	volatile unsigned int tail; /* Next element to read */
+	unsigned int mask; /* size-1 */
+	unsigned int esize;
+	char * buffer;
+};
+
+/* The elements have to be visible before the index that publishes them (and read
+ * before the index that frees their slots). A compiler barrier is enough on a single
+ * core, the data memory barrier orders them for another master too. */
+#if defined(__arm__) && !defined(RING_HOST)
+#define ring_barrier()	__asm__ __volatile__ ("mcr p15, 0, %0, c7, c10, 5;" : : "r" (0) : "memory")
+#else
+#define ring_barrier()	__asm__ __volatile__ ("" : : : "memory")
+#endif
+
+#define RING_INIT(buf, esize, size)	{ 0, 0, (size)-1, (esize), (char *)(buf) }
+
+static inline void ring_init(struct ring *r, void *buf, unsigned int esize, unsigned int size) {
+	r->head = 0;
+	r->tail = 0;
+	r->mask = size-1;
+	r->esize = esize;
+	r->buffer = buf;
+}
+
+static inline unsigned int ring_count(struct ring *r) {
+	return r->head - r->tail;
+}
+
+static inline unsigned int ring_space(struct ring *r) {
+	return r->mask + 1 - (r->head - r->tail);
+}
+
+static inline int ring_empty(struct ring *r) {
+	return r->head == r->tail;
+}
+
+static inline int ring_full(struct ring *r) {
+	return ring_space(r) == 0;
+}
+
+/* Copies 'bytes', a word at a time when both are aligned */
+static inline void ring_copy(char *dest, const char *src, unsigned int bytes) {
+	if ((((unsigned long)dest | (unsigned long)src) & 3) == 0) {
+		for (; bytes >= 4; bytes -= 4, dest += 4, src += 4) *(unsigned int *)dest = *(const unsigned int *)src;
+	}
+	while (bytes--) *dest++ = *src++;
+}
+
+/* Consumer: contiguous elements ready to be read, '*ptr' points to the first one.
+ * The rest (if any) wraps to the start of the buffer. Released by ring_commit_read. */
+static inline unsigned int ring_peek(struct ring *r, void **ptr) {
+	unsigned int tail = r->tail;
+	unsigned int n = r->head - tail;
+	unsigned int seg = r->mask + 1 - (tail & r->mask);
+
+	ring_barrier();
+	*ptr = r->buffer + (tail & r->mask) * r->esize;
+	return n < seg ? n : seg;
+}
+
+static inline void ring_commit_read(struct ring *r, unsigned int n) {
+	ring_barrier();
+	r->tail += n;
+}
+
+/* Producer: contiguous free slots, '*ptr' points to the first one. Published by ring_commit_write. */
+static inline unsigned int ring_peek_write(struct ring *r, void **ptr) {
+	unsigned int head = r->head;
+	unsigned int n = r->mask + 1 - (head - r->tail);
+	unsigned int seg = r->mask + 1 - (head & r->mask);
+
+	ring_barrier();
+	*ptr = r->buffer + (head & r->mask) * r->esize;
+	return n < seg ? n : seg;
+}
+
+static inline void ring_commit_write(struct ring *r, unsigned int n) {
+	ring_barrier();
+	r->head += n;
+}
+
+/* Producer: writes up to 'n' elements of 'src' (two segments at most). Returns the number written. */
+static inline unsigned int ring_write_n(struct ring *r, const void *src, unsigned int n) {
+	unsigned int seg, done = 0;
+	void * ptr;
+
+	while (done < n && (seg = ring_peek_write(r, &ptr)) > 0) {
+		if (seg > n - done) seg = n - done;
+		ring_copy(ptr, (const char *)src + done * r->esize, seg * r->esize);
+		ring_commit_write(r, seg);
+		done += seg;
+	}
+	return done;
+}
+
+/* Consumer: reads up to 'n' elements to 'dest'. Returns the number read. */
+static inline unsigned int ring_read_n(struct ring *r, void *dest, unsigned int n) {
+	unsigned int seg, done = 0;
+	void * ptr;
+
+	while (done < n && (seg = ring_peek(r, &ptr)) > 0) {
+		if (seg > n - done) seg = n - done;
+		ring_copy((char *)dest + done * r->esize, ptr, seg * r->esize);
+		ring_commit_read(r, seg);
+		done += seg;
+	}
+	return done;
+}
+
+/* Single element versions, return 0 if the ring was full/empty */
+static inline int ring_put(struct ring *r, const void *elem) {
+	return ring_write_n(r, elem, 1);
+}
+
+static inline int ring_get(struct ring *r, void *elem) {
+	return ring_read_n(r, elem, 1);
+}
+
+#endif /* __RING_H__ */
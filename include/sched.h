@@ -1,17 +1,46 @@
 #ifndef __SCHED_H__
 #define __SCHED_H__
 
+#include <file.h>
+#include <ipc.h>
 #include <list.h>
+#include <rbtree.h>
 #include <mm_address.h>
 #include <stats.h>
+#include <timer.h>
+#include <vfp.h>
 #include <types.h>
 
 
 #define NR_TASKS      10
+#define PIDHASH_SIZE	16	/* Power of two */
+#define pid_hashfn(pid)	((pid)&(PIDHASH_SIZE-1))
 #define KERNEL_STACK_SIZE	1024
 #define DEFAULT_RR_QUANTUM	1000
+#define NR_PRIO				32	/* Priority levels, higher value == more urgent */
+#define DEFAULT_PRIO		16
+#define KTHREAD_PRIO		(NR_PRIO-1)	/* Kernel threads run bottom halves, most urgent */
+#define NICE_MIN			-20
+#define NICE_MAX			19
+#define NICE_0_LOAD			1024	/* Weight of a nice 0 task */
+#define CFS_LATENCY			20	/* Ticks in which every runnable task should run once */
+#define CFS_MIN_GRANULARITY	4	/* Minimum slice (ticks) */
+#define CFS_WAKEUP_GRANULARITY	1000	/* vruntime (us) a woken task must lead by to preempt */
+#define MLFQ_BASE_QUANTUM	10	/* Quantum of the top level, doubled at each lower level */
+#define MLFQ_BOOST_PERIOD	1000	/* Ticks between moving every task back to the top level */
+#define EDF_MAX_UTILIZATION	950	/* Per mille of CPU the real-time tasks may reserve */
 #define INITAL_KERNEL_STACK &task[1].stack[KERNEL_STACK_SIZE-1]
 
+/* Scheduling policies, the one used is selected at build time (SCHED_POLICY) */
+#define SCHED_POLICY_RR		0
+#define SCHED_POLICY_PRIO	1
+#define SCHED_POLICY_CFS	2
+#define SCHED_POLICY_MLFQ	3
+
+#ifndef SCHED_POLICY
+#define SCHED_POLICY		SCHED_POLICY_RR
+#endif
+
 enum state_t { ST_RUN, ST_READY, ST_BLOCKED, ST_ZOMBIE };
 
 struct keyboard_info {
@@ -20,6 +49,21 @@ struct keyboard_info {
 		int keysread;
 };
 
+/* Real-time (EDF) parameters, in ticks. period == 0 for non real-time tasks */
+struct edf_info {
+		unsigned int period;
+		unsigned int runtime;
+		unsigned int deadline;		/* Relative to the release of each job */
+		unsigned int release;		/* Release time of the next job */
+		unsigned int abs_deadline;	/* Deadline of the current job */
+		unsigned int budget;		/* Runtime left to the current job */
+		char job_done;				/* Current job finished (waiting for the next period) */
+		char job_missed;			/* Current job already counted as a miss */
+		struct list_head rt_list;	/* edf_tasks */
+};
+
+/* The entry stubs store the user sp/lr in the first words (TASK_USER_LR, asm.h),
+ * the new fields go after user_lr */
 struct task_struct {
 	int PID;
 	fl_page_table_entry * dir_pages_baseAddr;
@@ -28,15 +72,39 @@ struct task_struct {
 	unsigned int kernel_lr;
 	unsigned int user_sp;
 	unsigned int user_lr;
+	struct list_head pid_list; /* pid_hash chain */
+	struct rb_node run_node; /* Fair scheduler timeline */
 
+	struct vfp_state vfp;
 	struct stats statistics;
+	struct sched_hist hist;
+	unsigned int ready_ts; /* us when it became READY */
+	unsigned int run_ts; /* us when it got the CPU */
 	enum state_t process_state;
+	struct edf_info edf;
+	unsigned int mlfq_boost; /* Last priority boost seen by the task */
+
+	/* Kernel threads: function run in kernel mode and its argument, NULL for user tasks */
+	void (*kthread_fn)(void *);
+	void * kthread_arg;
 
 	/* Needed to implement Threads */
 	Byte *dir_count; /* Pointer to the references of its own directory */
 
+	struct file * fds[NR_OPEN]; /* Open files, inherited by fork/clone */
+
 	/* Read syscall */
 	struct keyboard_info kbinfo;
+	struct ktimer sleep_timer; /* Wakes it up from the sleepqueue */
+	unsigned int futex_key; /* Physical address of the futex it waits on */
+
+	/* Synchronous IPC */
+	struct ipc_msg ipc_msg; /* Message received (request or reply) */
+	int ipc_from; /* Client of the request received */
+	int ipc_ret; /* Result of the call, set by the server */
+	int ipc_receiving; /* Blocked in ipc_reply_wait waiting for a request */
+	struct list_head ipc_senders; /* Clients blocked calling it */
+	struct list_head ipc_replyqueue; /* Clients whose request it has received */
 
 	/* HEAP variables */
 	unsigned int *program_break;
@@ -53,6 +121,15 @@ extern struct task_struct *idle_task;
 extern struct list_head freequeue;
 extern struct list_head readyqueue;
 extern struct list_head keyboardqueue;
+extern struct list_head sleepqueue;
+extern struct list_head pid_hash[PIDHASH_SIZE];
+extern struct list_head prio_queue[NR_PRIO];
+extern unsigned int prio_bitmap;
+extern struct rb_root cfs_timeline;
+extern struct list_head mlfq_queue[MLFQ_LEVELS];
+extern struct list_head edf_readyqueue;
+extern struct list_head edf_periodqueue;
+extern struct list_head edf_tasks;
 extern struct task_struct * idle_task;
 extern unsigned int rr_quantum;
 extern int lastPID;
@@ -60,9 +137,15 @@ extern int lastPID;
 void init_freequeue();
 void init_readyqueue();
 void init_keyboardqueue();
+void init_sleepqueue();
 
 void init_task1();
+void cpu_idle();
+unsigned int sched_next_event();
 void init_idle();
+
+struct task_struct * kthread_create(void (*fn)(void *), void * arg);
+void kthread_exit();
 void init_sched();
 void init_semarray();
 
@@ -71,8 +154,11 @@ struct task_struct * current();
 void task_switch_wrapper(union task_union *new);
 void task_switch(union task_union *new, unsigned int last_sp);
 
-int getNewPID();
-int getStructPID(int PID, struct list_head * queue, struct task_struct ** pointer_to_desired);
+void init_pidhash();
+void pid_hash_add(struct task_struct * t);
+void pid_hash_del(struct task_struct * t);
+int getNewPID(struct task_struct * t);
+struct task_struct * find_task_by_pid(int PID);
 
 struct task_struct *list_head_to_task_struct(struct list_head *l);
 
@@ -107,5 +193,79 @@ void sched_switch_process_RR();
 
 void sched_update_queues_state_RR(struct list_head* ls, struct task_struct * task);
 
+/* Priority policy scheduler initialization. One queue per priority level, the
+ * highest non-empty level is found with a CLZ over the priority bitmap. */
+void init_Sched_PRIO();
+
+void sched_update_data_PRIO();
+
+int sched_change_needed_PRIO();
+
+void sched_switch_process_PRIO();
+
+void sched_update_queues_state_PRIO(struct list_head* ls, struct task_struct * task);
+
+/* Completely fair policy scheduler initialization. Ready tasks are sorted by virtual
+ * runtime (CPU time weighted by nice) on a red-black tree, the leftmost one runs. */
+void init_Sched_CFS();
+
+void sched_update_data_CFS();
+
+int sched_change_needed_CFS();
+
+void sched_switch_process_CFS();
+
+void sched_update_queues_state_CFS(struct list_head* ls, struct task_struct * task);
+
+/* Multi-level feedback queue policy scheduler initialization. Tasks that use their whole
+ * quantum sink to levels with longer quanta, tasks that block rise. */
+void init_Sched_MLFQ();
+
+void sched_update_data_MLFQ();
+
+int sched_change_needed_MLFQ();
+
+void sched_switch_process_MLFQ();
+
+void sched_update_queues_state_MLFQ(struct list_head* ls, struct task_struct * task);
+
+/* Earliest deadline first real-time class. It is stacked above the policy initialized
+ * before it: real-time tasks always run first, the rest is left to that policy. */
+void init_Sched_EDF();
+
+void sched_update_data_EDF();
+
+int sched_change_needed_EDF();
+
+void sched_switch_process_EDF();
+
+void sched_update_queues_state_EDF(struct list_head* ls, struct task_struct * task);
+
+/* Gives the CPU to the task selected by the policy */
+void sched_task_switch(struct task_struct * task);
+
+/* Gives the CPU to a blocked task, without the policy (IPC) */
+void sched_switch_to(struct task_struct * task);
+
+/* Synchronous IPC state of a task (ipc.c) */
+void ipc_init(struct task_struct *t);
+void ipc_release(struct task_struct *t);
+
+/* Clears the scheduling latency histograms of a task */
+void init_sched_hist(struct task_struct * task);
+
+/* Changes the priority of a task */
+void sched_set_priority(struct task_struct * task, int prio);
+
+/* Changes the nice value (weight) of a task */
+void sched_set_nice(struct task_struct * task, int nice);
+
+/* Declares (or clears with period == 0) the real-time parameters of a task */
+int sched_set_deadline(struct task_struct * task, unsigned int period, unsigned int runtime,
+					   unsigned int deadline);
+
+/* Ends the current job of a real-time task, blocks until the next release */
+int sched_wait_period();
+
 
 #endif  /* __SCHED_H__ */
@@ -8,6 +8,7 @@ typedef struct {
 		unsigned int value;
 		int pid_owner;
 		struct list_head semqueue;
+		struct list_head pollers; /* Tasks in 'poll' waiting for value > 0 */
 }Sem;
 
 #endif /* __SEMAPHORE__ */
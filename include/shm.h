@@ -0,0 +1,7 @@
+#ifndef __SHM_H__
+#define __SHM_H__
+
+#define SHM_SIZE		8	/* Shared memory regions, identified by 0..SHM_SIZE-1 */
+#define SHM_MAX_PAGES	16	/* Pages of a region, 64KB at most */
+
+#endif /* __SHM_H__ */
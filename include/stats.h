@@ -1,12 +1,73 @@
 #ifndef __STATS_H__
 #define __STATS_H__
 
+#define MLFQ_LEVELS 4 /* Levels of the multi-level feedback queue scheduler */
+#define HIST_BUCKETS 20 /* log2 buckets (us): [0,2), [2,4), [4,8) ... [2^19,inf) */
+
+/* Versions of the structure filled by 'get_stats_v' */
+#define STATS_V1 1 /* struct stats, same as 'get_stats' */
+#define STATS_V2 2 /* struct stats_v2 */
+
 /* Structure used by 'get_stats' function */
 struct stats
 {
 	unsigned int tics;
 	unsigned int cs; /* Number of times the process has got the CPU: READY->RUN transitions */
     unsigned int remaining_quantum;
+	unsigned int priority; /* Priority level used by the priority scheduler */
+	int nice; /* Weight of the task for the fair scheduler (-20..19) */
+	unsigned int vruntime; /* Weighted CPU time (us) consumed, fair scheduler */
+	unsigned int deadline_misses; /* Jobs of a real-time task that missed their deadline */
+	unsigned int level; /* Current level on the multi-level feedback queue */
+	unsigned int level_tics[MLFQ_LEVELS]; /* Tics run at each level */
+};
+
+/* Scheduling latency histograms of a task, times taken from the 1MHz system timer */
+struct sched_hist
+{
+	unsigned int wakeup[HIST_BUCKETS]; /* From becoming READY (woken up, preempted, created) to RUN */
+	unsigned int run[HIST_BUCKETS]; /* Time on the CPU each time it got it */
+	unsigned int wakeup_max;
+	unsigned int run_max;
+};
+
+/* Structure used by 'get_stats_v' function with STATS_V2 */
+struct stats_v2
+{
+	struct stats st;
+	struct sched_hist hist;
+};
+
+#define WORK_NAME_LEN 16
+
+/* Structure used by 'get_work_stats' function, execution of a deferred work item */
+struct work_stats
+{
+	char name[WORK_NAME_LEN];
+	unsigned int runs;
+	unsigned int total_us; /* Time from its start to its end, summed over all the runs */
+	unsigned int max_us;
+	unsigned int last_us;
+	unsigned int max_delay_us; /* Longest time queued before it started */
+};
+
+/* Structure used by 'get_sys_stats' function, system wide counters */
+struct sys_stats
+{
+	unsigned int suppressed_ticks; /* Timer interrupts avoided while idle (tickless) */
+	unsigned int vfp_switches; /* VFP registers handed over to another task (lazy switch) */
+	unsigned int tlb_flushes_avoided; /* Address space switches done by ASID, without TLB flush */
+	unsigned int asid_rollovers; /* ASIDs ran out: full TLB flush */
+	unsigned int uart_rx_bytes; /* Bytes received by the uart */
+	unsigned int uart_rx_overruns; /* Bytes received and dropped, the read buffer was full */
+	unsigned int uart_rx_fifo_overruns; /* The uart rx fifo overflowed (bytes lost in the hardware) */
+	unsigned int uart_tx_bytes; /* Bytes sent by the uart, from the transmit ring */
+	unsigned int uart_tx_irqs; /* Uart tx empty interrupts */
+	unsigned int uart_tx_stalls; /* Writers blocked because the transmit ring was full */
+	unsigned int pipe_bytes; /* Bytes read from pipes */
+	unsigned int pipe_pages_moved; /* Pages of pipes given to the reader by moving the frame */
+	unsigned int pipe_read_blocks; /* Reads blocked on an empty pipe */
+	unsigned int pipe_write_blocks; /* Writes blocked on a full pipe */
 };
 
 #endif /* __STATS_H__ */
@@ -1,11 +1,12 @@
 #ifndef __SYSTEM_H__
 #define __SYSTEM_H__
 
-#include <cbuffer.h>
+#include <ring.h>
 #include <sem.h>
 #include <types.h>
 
-extern Circular_Buffer uart_read_buffer;
+extern struct ring uart_read_buffer;
+extern struct ring uart_write_buffer;
 extern Sem sem_array[SEM_SIZE];
 
 #endif  /* __SYSTEM_H__ */
@@ -0,0 +1,27 @@
+#ifndef __TERMIOS_H__
+#define __TERMIOS_H__
+
+/* Line discipline of the uart (fd 0), set with tcsetattr */
+#define NCCS	5
+
+/* c_cc indices */
+#define VERASE	0	/* Erase the last character (canonical) */
+#define VKILL	1	/* Erase the line (canonical) */
+#define VEOF	2	/* Ends the line without a newline, read returns 0 on an empty line */
+#define VMIN	3	/* Raw: bytes a read waits for (at most the size of the read) */
+#define VTIME	4	/* Raw: timeout in tenths of second. With VMIN > 0 it runs from the
+				 * last byte received, with VMIN == 0 from the start of the read */
+
+/* c_lflag bits */
+#define ICANON	0x1	/* Canonical mode: reads are woken by whole lines */
+#define ECHO	0x2	/* Echo the input */
+
+/* tcsetattr actions */
+#define TCSANOW	0
+
+struct termios {
+	unsigned int c_lflag;
+	unsigned char c_cc[NCCS];
+};
+
+#endif /* __TERMIOS_H__ */
@@ -0,0 +1,18 @@
+#ifndef __TIMEPAGE_H__
+#define __TIMEPAGE_H__
+
+/* Pages mapped read-only for user mode in every task, right below the user code.
+ * libc reads them instead of doing the gettime/getpid syscalls. */
+#define TIME_PAGE_ADDR		0xFF000
+#define TIME_STIMER_ADDR	0xFE000	/* BCM2835 system timer (ph 0x20003000) */
+#define TIME_STIMER_CLO		(TIME_STIMER_ADDR+0x04)	/* 1MHz free-running counter */
+
+/* Data published by the kernel, every field is a single word updated atomically */
+struct time_page {
+	volatile unsigned int clock; /* Ticks (ms) since boot, the value of the gettime syscall */
+	volatile int pid; /* PID of the running task */
+};
+
+#define time_page_user	((struct time_page *)TIME_PAGE_ADDR)
+
+#endif /* __TIMEPAGE_H__ */
@@ -3,6 +3,9 @@
 
 #include <types.h>
 #include <utils.h>
+#include <list.h>
+#include <mm_address.h>
+#include <timepage.h>
 
 
 #define TIMER_BASE_PH		0x2000B000
@@ -13,14 +16,66 @@
 #define TIMER_CNTL			(TIMER_BASE+0x408)
 #define TIMER_IRQ_CLR		(TIMER_BASE+0x40C)
 #define TIMER_RAQ_IRQ		(TIMER_BASE+0x410)
-#define TIMER_MSKD_IRQ		(TIMER_BASE+0x404)
-#define TIMER_RELOAD		(TIMER_BASE+0x408)
-#define TIMER_PREDIVIDER	(TIMER_BASE+0x40C)
+#define TIMER_MSKD_IRQ		(TIMER_BASE+0x414)
+#define TIMER_RELOAD		(TIMER_BASE+0x418)
+#define TIMER_PREDIVIDER	(TIMER_BASE+0x41C)
 #define TIMER_FREE_RUNNING	(TIMER_BASE+0x420)
 
+/* BCM2835 system timer, 1MHz free-running counter not affected by the core clock */
+#define STIMER_BASE_PH		0x20003000
+#define STIMER_BASE			TIME_STIMER_ADDR	/* ph 0x20003000, user read-only */
+
+#define STIMER_CS			(STIMER_BASE+0x00)
+#define STIMER_CLO			(STIMER_BASE+0x04)
+#define STIMER_CHI			(STIMER_BASE+0x08)
+
+#define TIMER_TICK			1000	/* Timer counts per tick (1ms) */
+#define TICKLESS_MAX_TICKS	4000	/* Longest idle period without tick, fits the 23 bit counter */
+
+/* Hierarchical timer wheel: 256 one-tick slots, then 3 levels of 64 slots (26 bits of ticks) */
+#define TVR_BITS			8
+#define TVN_BITS			6
+#define TVN_LEVELS			3
+#define TVR_SIZE			(1<<TVR_BITS)
+#define TVN_SIZE			(1<<TVN_BITS)
+#define TVR_MASK			(TVR_SIZE-1)
+#define TVN_MASK			(TVN_SIZE-1)
+#define TV_MAX_TICKS		(1<<(TVR_BITS+TVN_LEVELS*TVN_BITS))
+
+/* Tick comparison that survives the wrap around of the clock */
+#define time_after_eq(a,b)	((int)((a)-(b)) >= 0)
+
+/* Kernel timer: 'function' is called from the timer interrupt at tick 'expires' */
+struct ktimer {
+	struct list_head list; /* next == NULL when it is not pending */
+	unsigned int expires;
+	void (*function)(struct ktimer *t);
+	void * data;
+};
+
+/* Page shared read-only with the user tasks at TIME_PAGE_ADDR */
+union time_page_union {
+	struct time_page tp;
+	Byte page[PAGE_SIZE];
+};
+extern union time_page_union time_page;
+
+/* Timer interrupts not generated while the CPU was idle */
+extern unsigned int suppressed_ticks;
+
 void init_timer();
 void timer_clear_irq();
 void timer_set_initial_time(unsigned int time);
+unsigned int timer_get_us();
+
+void tick_stop(unsigned int ticks);
+unsigned int tick_restart();
+
+void init_ktimer(struct ktimer *t, void (*function)(struct ktimer *t), void * data);
+void ktimer_add(struct ktimer *t, unsigned int expires);
+void ktimer_del(struct ktimer *t);
+int ktimer_pending(struct ktimer *t);
+unsigned int timer_next_event();
 
 void clock_increase();
 unsigned int clock_get_time();
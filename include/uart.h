@@ -24,6 +24,10 @@
 #define AUX_MU_STAT_REG	(AUX_BASE+0x64)
 #define AUX_MU_BAUD_REG	(AUX_BASE+0x68)
 
+/* AUX_MU_LSR_REG bits, reading the register clears the overrun */
+#define AUX_MU_LSR_DATA_READY	0x01
+#define AUX_MU_LSR_RX_OVERRUN	0x02
+
 /* Calculated using formula on Broadcom datasheet:
  * baudrate_reg = ((system_clock_freq/(baudrate*8))-1);
  * where system_clock_freq == 250MHz.	*/
@@ -36,8 +40,13 @@ void init_uart();
 Byte uart_interrupt_pend();
 Byte uart_interrupt_pend_rx();
 Byte uart_interrupt_pend_tx();
+void uart_toggle_tx_interrupt(unsigned char enable);
 
+Byte uart_tx_ready();
+Byte uart_line_status();
+Byte uart_data_available();
 void uart_send_byte(Byte c);
+void uart_put_byte(Byte c);
 Byte uart_get_byte();
 
 #endif  /* __UART_H__ */
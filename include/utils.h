@@ -34,6 +34,8 @@ inline unsigned int get_value_from(unsigned int address);
 
 void delay();
 
+unsigned int udiv(unsigned int n, unsigned int d);
+
 
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef __VFP_H__
+#define __VFP_H__
+
+#include <types.h>
+
+/* ARM1176JZF-S VFP11 (VFPv2) coprocessor, cp10 single and cp11 double precision */
+#define CPACR_VFP_FULL		(0xF<<20)	/* cp10/cp11 full access */
+
+#define FPEXC_EN			(1<<30)		/* VFP enabled */
+#define FPEXC_EX			(1<<31)		/* Exceptional state, needs support code */
+
+/* Default FPSCR: RunFast mode (flush-to-zero, default NaN, no exception traps), so the
+ * VFP11 never bounces instructions to a support code that zeOS does not have */
+#define FPSCR_FZ			(1<<24)
+#define FPSCR_DN			(1<<25)
+#define FPSCR_DEFAULT		(FPSCR_FZ|FPSCR_DN)
+
+#define VFP_SREGS			32
+
+/* VFP registers of a task, only up to date when the task does not own the VFP */
+struct vfp_state {
+	unsigned int s[VFP_SREGS]; /* s0-s31 == d0-d15 */
+	unsigned int fpscr;
+};
+
+struct task_struct;
+
+/* Task whose state is loaded in the VFP registers, NULL if none */
+extern struct task_struct * vfp_owner;
+/* Times the VFP registers were handed to another task */
+extern unsigned int vfp_switches;
+
+void init_vfp();
+void vfp_init_state(struct vfp_state * st);
+void vfp_task_switch(struct task_struct * next);
+int vfp_trap(unsigned int instr);
+void vfp_flush(struct task_struct * t);
+void vfp_release(struct task_struct * t);
+
+#endif /* __VFP_H__ */
@@ -0,0 +1,37 @@
+#ifndef __WORKQUEUE_H__
+#define __WORKQUEUE_H__
+
+#include <list.h>
+#include <stats.h>
+#include <types.h>
+
+#define NR_WORKS	16	/* Work items registered for 'get_work_stats' */
+
+/* Deferred work: 'func' runs later in a kernel thread, with IRQs enabled */
+struct work_struct {
+	struct list_head list;
+	void (*func)(struct work_struct *work);
+	char pending; /* Queued and not started yet */
+	unsigned int queued_us;
+	struct work_stats stats;
+};
+
+/* Queue of works served, in order, by its own kernel thread */
+struct workqueue {
+	struct list_head works;
+	struct list_head idle; /* The worker while there is nothing to do */
+	struct task_struct * worker;
+};
+
+/* Workqueue of the system, for the interrupt bottom halves */
+extern struct workqueue system_wq;
+
+void init_work(struct work_struct *work, char *name, void (*func)(struct work_struct *work));
+int init_workqueue(struct workqueue *wq);
+int queue_work(struct workqueue *wq, struct work_struct *work);
+int schedule_work(struct work_struct *work);
+struct work_struct * get_work(int id);
+
+void init_workqueues();
+
+#endif /* __WORKQUEUE_H__ */
@@ -37,7 +37,9 @@ void reset_routine() {
 	while(1);
 }
 
-void undefined_instruction_routine() {
+/* Only the first VFP instruction of a task after a task switch is expected here */
+void undefined_instruction_routine(unsigned int instr) {
+	if (vfp_trap(instr)) return;
 	while(1);
 }
 
@@ -50,6 +52,9 @@ void data_abort_routine() {
 }
 
 void interrupt_request_routine() {
+	/* Leaving a tickless idle period: catch up the clock */
+	idle_task->statistics.tics += tick_restart();
+
 	if (get_value_from(IRQ_PEND_B)&0b1) { // TIMER
 		timer_clear_irq();
 		clock_increase();
@@ -65,8 +70,15 @@ void interrupt_request_routine() {
 			if (uart_interrupt_pend_rx()) {
 				interrupt_uart_routine();
 			}
+			else if (uart_interrupt_pend_tx()) {
+				interrupt_uart_tx_routine();
+			}
 		}
 	}
+
+	/* Do not wait for the next tick to serve a task woken up by the interrupt
+	 * (keyboard waiter, uart writer, kernel worker) */
+	if (current() == idle_task) sched_switch_process();
 }
 
 void fast_interrupt_request_routine() {
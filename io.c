@@ -1,9 +1,9 @@
 #include <io.h>
-#include <uart.h>
+#include <devices.h>
 
 /* Print char */
 void printc(char c) {
-	uart_send_byte(c);
+	uart_putc(c);
 }
 
 /* Print string */
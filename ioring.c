@@ -0,0 +1,287 @@
+#include <ioring.h>
+#include <devices.h>
+#include <errno.h>
+#include <list.h>
+#include <mm.h>
+#include <mm_address.h>
+#include <sched.h>
+#include <system.h>
+#include <utils.h>
+#include <workqueue.h>
+
+#define IO_CHUNK	32	/* Bytes copied from a task per write chunk */
+
+/* Request in flight, 'task' is NULL while it is free */
+struct io_kiocb {
+	struct list_head list; /* Free list of its context or queue of the device */
+	struct task_struct * task;
+	struct io_sqe sqe; /* Private copy, the task can rewrite the shared one */
+	int done; /* Bytes transferred */
+};
+
+/* Kernel side of the ring of a task. The indices the kernel writes on the shared page
+ * are copies of these, the ones the task writes are never trusted. */
+struct io_ctx {
+	struct io_ring * ring; /* Shared page, NULL if io_setup has not been called */
+	unsigned int sq_head;
+	unsigned int cq_tail;
+	unsigned int inflight;
+	unsigned int wait_nr; /* Completions io_enter waits for, 0 if it is not waiting */
+	struct list_head free;
+	struct io_kiocb kiocbs[IORING_ENTRIES];
+};
+
+union io_ring_union {
+	struct io_ring ring;
+	Byte page[PAGE_SIZE];
+};
+
+/* Shared pages, one per task slot, mapped at IORING_FIRST_PAG_D1 + slot */
+static union io_ring_union io_ring_pages[NR_TASKS] __attribute__((__section__(".data.io_rings")));
+static struct io_ctx io_ctxs[NR_TASKS];
+
+static struct list_head io_readqueue; /* Reads served, in order, by the UART interrupt */
+static struct list_head io_writequeue; /* Writes served, in order, by 'io_write_work' */
+static struct list_head io_waitqueue; /* Tasks blocked in io_enter */
+static struct work_struct io_write_work;
+
+static struct io_ctx * io_get_ctx(struct task_struct *t) {
+	return &io_ctxs[(union task_union *)t - task];
+}
+
+/* Posts the completion of a request on the CQ of 't' and wakes it up if it has enough */
+static void io_post_cqe(struct task_struct *t, unsigned int user_data, int res) {
+	struct io_ctx * ctx = io_get_ctx(t);
+	struct io_ring * r = ctx->ring;
+	struct io_cqe * cqe;
+
+	if (ctx->cq_tail - r->cq_head >= IORING_CQ_ENTRIES) ++(r->cq_overflow);
+	else {
+		cqe = &r->cqes[ctx->cq_tail % IORING_CQ_ENTRIES];
+		cqe->user_data = user_data;
+		cqe->res = res;
+		r->cq_tail = ++(ctx->cq_tail);
+	}
+
+	if (ctx->wait_nr && (ctx->cq_tail - r->cq_head >= ctx->wait_nr || ctx->inflight == 0)) {
+		ctx->wait_nr = 0;
+		list_del(&t->list);
+		sched_update_queues_state(&readyqueue, t);
+	}
+}
+
+/* Frees a request (out of any device queue) and posts its result */
+static void io_complete(struct io_kiocb *req, int res) {
+	struct task_struct * t = req->task;
+	struct io_ctx * ctx = io_get_ctx(t);
+
+	req->task = NULL;
+	list_add_tail(&req->list, &ctx->free);
+	--(ctx->inflight);
+	io_post_cqe(t, req->sqe.user_data, res);
+}
+
+/* Gives the input of the line discipline to the pending reads, oldest first. Blocked
+ * 'read' syscalls go before them, the input stays in the buffer for those. */
+void io_uart_drain() {
+	struct io_kiocb * req;
+	char complete;
+	int n;
+
+	while (!list_empty(&io_readqueue) && tty_async_ready()) {
+		req = list_entry(list_first(&io_readqueue), struct io_kiocb, list);
+
+		n = tty_async_read(req->task, req->sqe.buf + req->done, req->sqe.len - req->done, &complete);
+		if (n < 0) {
+			list_del(&req->list);
+			io_complete(req, n);
+			continue;
+		}
+		req->done += n;
+		if (req->done == req->sqe.len || complete) {
+			list_del(&req->list);
+			io_complete(req, req->done);
+		}
+	}
+}
+
+/* Bottom half of the writes. Copies a chunk with IRQs disabled (the queue and the
+ * memory of the task can change) and queues it on the uart transmit ring with IRQs
+ * enabled, sleeping while the ring is full. A write completes once its last chunk
+ * has been taken. */
+static void io_write_worker(struct work_struct *work) {
+	char chunk[IO_CHUNK];
+	struct io_kiocb * req;
+	int n;
+
+	while (1) {
+		__asm__ __volatile__ ("cpsid i;");
+		if (list_empty(&io_writequeue)) break;
+		req = list_entry(list_first(&io_writequeue), struct io_kiocb, list);
+
+		n = req->sqe.len - req->done;
+		if (n > IO_CHUNK) n = IO_CHUNK;
+		if (copy_from_task(req->task, req->sqe.buf + req->done, chunk, n) < 0) {
+			list_del(&req->list);
+			io_complete(req, -ENACCB);
+			__asm__ __volatile__ ("cpsie i;");
+			continue;
+		}
+		req->done += n;
+		if (req->done == req->sqe.len) {
+			list_del(&req->list);
+			io_complete(req, req->done);
+		}
+		__asm__ __volatile__ ("cpsie i;");
+
+		sys_write_uart(chunk, n);
+	}
+	__asm__ __volatile__ ("cpsie i;");
+}
+
+/* Checks a submission entry, same rules as the read/write syscalls.
+ * Only the uart has asynchronous operations. */
+static int io_check_sqe(struct io_sqe *sqe) {
+	struct file * f;
+
+	if (sqe->opcode == IORING_OP_NOP) return 0;
+
+	f = file_get(current(), sqe->fd);
+	switch (sqe->opcode) {
+		case IORING_OP_READ:
+			if (f == NULL) return -EBADF;
+			if (!file_readable(f)) return -EACCES;
+			if (f->ops != &uart_fops) return -EINVAL;
+			break;
+		case IORING_OP_WRITE:
+			if (f == NULL) return -EBADF;
+			if (!file_writable(f)) return -EACCES;
+			if (f->ops != &uart_fops) return -EINVAL;
+			break;
+		default:
+			return -EINVAL;
+	}
+	if (sqe->buf == NULL) return -EPNULL;
+	if (sqe->len <= 0) return -ESIZEB;
+	/* The worker and the interrupt copy with kernel privileges */
+	if (access_ok(sqe->opcode == IORING_OP_READ ? VERIFY_WRITE : VERIFY_READ, sqe->buf, sqe->len) == 0)
+		return -ENACCB;
+	return 0;
+}
+
+/* Starts a request, the NOPs and the invalid ones complete at once */
+static void io_submit(struct io_kiocb *req) {
+	int ret = io_check_sqe(&req->sqe);
+
+	if (ret < 0 || req->sqe.opcode == IORING_OP_NOP) {
+		io_complete(req, ret);
+		return;
+	}
+
+	if (req->sqe.opcode == IORING_OP_READ) {
+		list_add_tail(&req->list, &io_readqueue);
+		io_uart_drain();
+	}
+	else {
+		list_add_tail(&req->list, &io_writequeue);
+		schedule_work(&io_write_work);
+	}
+}
+
+/* Syscall io_setup, maps the ring of the current task (once) and returns its address */
+int sys_io_setup() {
+	struct task_struct * current_pcb = current();
+	struct io_ctx * ctx = io_get_ctx(current_pcb);
+	sl_page_table_entry * pt_current = get_PT(current_pcb,1);
+	unsigned int slot = (union task_union *)current_pcb - task;
+	unsigned int page = IORING_FIRST_PAG_D1 + slot;
+	unsigned int * p;
+	int i;
+
+	if (ctx->ring == NULL) {
+		if (check_used_page(&pt_current[page])) return -ENOMEM;
+
+		ctx->ring = &io_ring_pages[slot].ring;
+		for (p = (unsigned int *)&io_ring_pages[slot]; p < (unsigned int *)&io_ring_pages[slot+1]; p++) *p = 0;
+		ctx->sq_head = 0;
+		ctx->cq_tail = 0;
+		ctx->inflight = 0;
+		ctx->wait_nr = 0;
+		INIT_LIST_HEAD(&ctx->free);
+		for (i = 0; i < IORING_ENTRIES; i++) {
+			ctx->kiocbs[i].task = NULL;
+			list_add_tail(&ctx->kiocbs[i].list, &ctx->free);
+		}
+
+		set_ss_pag(pt_current, page, PH_PAGE((unsigned int)ctx->ring));
+	}
+
+	return L_USER_START + (page<<OFFSET_BITS);
+}
+
+/* Syscall io_enter, submits up to 'to_submit' entries of the SQ and blocks until there are
+ * 'min_complete' completions on the CQ (or no more requests in flight). Returns the number
+ * of entries consumed, fewer if the SQ had less or IORING_ENTRIES are already in flight. */
+int sys_io_enter(unsigned int to_submit, unsigned int min_complete) {
+	struct task_struct * current_pcb = current();
+	struct io_ctx * ctx = io_get_ctx(current_pcb);
+	struct io_ring * r = ctx->ring;
+	struct io_kiocb * req;
+	unsigned int sq_tail;
+	unsigned int submitted = 0;
+
+	if (r == NULL) return -EINVAL;
+	sq_tail = r->sq_tail;
+	if (sq_tail - ctx->sq_head > IORING_ENTRIES) return -EINVAL;
+
+	while (submitted < to_submit && ctx->sq_head != sq_tail && !list_empty(&ctx->free)) {
+		req = list_entry(list_first(&ctx->free), struct io_kiocb, list);
+		list_del(&req->list);
+
+		copy_data(&r->sqes[ctx->sq_head % IORING_ENTRIES], &req->sqe, sizeof(struct io_sqe));
+		r->sq_head = ++(ctx->sq_head);
+		req->task = current_pcb;
+		req->done = 0;
+		++(ctx->inflight);
+		++submitted;
+
+		io_submit(req);
+	}
+
+	if (min_complete > IORING_CQ_ENTRIES) min_complete = IORING_CQ_ENTRIES;
+	while (ctx->cq_tail - r->cq_head < min_complete && ctx->inflight > 0) {
+		ctx->wait_nr = min_complete;
+		sched_update_queues_state(&io_waitqueue, current_pcb);
+		sched_switch_process();
+	}
+
+	return submitted;
+}
+
+/* Cancels the requests in flight of an exiting task and unmaps its ring */
+void io_release(struct task_struct *t) {
+	struct io_ctx * ctx = io_get_ctx(t);
+	unsigned int slot = (union task_union *)t - task;
+	int i;
+
+	if (ctx->ring == NULL) return;
+
+	for (i = 0; i < IORING_ENTRIES; i++) {
+		if (ctx->kiocbs[i].task != NULL) list_del(&ctx->kiocbs[i].list);
+	}
+	ctx->ring = NULL;
+
+	del_ss_pag(get_PT(t,1), IORING_FIRST_PAG_D1 + slot);
+	mmu_flush_tlb(get_DIR(t));
+}
+
+/* Initializes the asynchronous I/O (after the workqueues) */
+void init_ioring() {
+	int i;
+
+	for (i = 0; i < NR_TASKS; i++) io_ctxs[i].ring = NULL;
+	INIT_LIST_HEAD(&io_readqueue);
+	INIT_LIST_HEAD(&io_writequeue);
+	INIT_LIST_HEAD(&io_waitqueue);
+	init_work(&io_write_work, "io_write", io_write_worker);
+}
@@ -0,0 +1,111 @@
+#include <ipc.h>
+#include <errno.h>
+#include <sched.h>
+#include <utils.h>
+
+/* Servers blocked in 'ipc_reply_wait' waiting for a request */
+static LIST_HEAD(ipc_waitqueue);
+
+/* Initializes the IPC state of a new task */
+void ipc_init(struct task_struct *t) {
+	t->ipc_receiving = 0;
+	INIT_LIST_HEAD(&t->ipc_senders);
+	INIT_LIST_HEAD(&t->ipc_replyqueue);
+}
+
+/* The request of 'client' is received by 'server', the client waits for the reply */
+static void ipc_receive(struct task_struct *server, struct task_struct *client) {
+	server->ipc_msg = client->ipc_msg;
+	server->ipc_from = client->PID;
+	sched_update_queues_state(&server->ipc_replyqueue, client);
+}
+
+/* Syscall ipc_call, sends '*umsg' to the task 'pid' and blocks until it replies, the
+ * reply overwrites '*umsg'. A server waiting for requests runs at once: the CPU goes
+ * straight from the client to the server, without the ready queue. */
+int sys_ipc_call(int pid, struct ipc_msg *umsg) {
+	struct task_struct * current_pcb = current();
+	struct task_struct * server;
+
+	if (umsg == NULL) return -EPNULL;
+	if (access_ok(VERIFY_WRITE, umsg, sizeof(struct ipc_msg)) == 0) return -ENACCB;
+	server = find_task_by_pid(pid);
+	if (server == NULL || server == current_pcb || server == idle_task) return -ENSPID;
+	if (server->kthread_fn != NULL) return -ENSPID;
+
+	copy_from_user(umsg, &current_pcb->ipc_msg, sizeof(struct ipc_msg));
+	current_pcb->ipc_ret = 0;
+
+	if (server->ipc_receiving) {
+		server->ipc_receiving = 0;
+		list_del(&server->list);
+		ipc_receive(server, current_pcb);
+		sched_switch_to(server);
+	}
+	else {
+		sched_update_queues_state(&server->ipc_senders, current_pcb);
+		sched_switch_process();
+	}
+
+	/* Replied (or the server exited) */
+	if (current_pcb->ipc_ret < 0) return current_pcb->ipc_ret;
+	copy_to_user(&current_pcb->ipc_msg, umsg, sizeof(struct ipc_msg));
+	return 0;
+}
+
+/* Syscall ipc_reply_wait, sends '*umsg' as the reply to the client 'reply_pid' (none
+ * if it is negative) and blocks until the next request, that overwrites '*umsg'.
+ * Returns the PID of the client. With no requests pending the CPU goes straight to
+ * the client replied. */
+int sys_ipc_reply_wait(int reply_pid, struct ipc_msg *umsg) {
+	struct task_struct * current_pcb = current();
+	struct task_struct * client = NULL, * t;
+	struct list_head * pos;
+
+	if (umsg == NULL) return -EPNULL;
+	if (access_ok(VERIFY_WRITE, umsg, sizeof(struct ipc_msg)) == 0) return -ENACCB;
+
+	if (reply_pid >= 0) {
+		list_for_each(pos, &current_pcb->ipc_replyqueue) {
+			t = list_head_to_task_struct(pos);
+			if (t->PID == reply_pid) client = t;
+		}
+		if (client == NULL) return -ENSPID;
+
+		list_del(&client->list);
+		copy_from_user(umsg, &client->ipc_msg, sizeof(struct ipc_msg));
+		client->ipc_ret = 0;
+	}
+
+	if (!list_empty(&current_pcb->ipc_senders)) {
+		/* The next request is already here, the client replied waits for the CPU */
+		pos = list_first(&current_pcb->ipc_senders);
+		list_del(pos);
+		ipc_receive(current_pcb, list_head_to_task_struct(pos));
+		if (client) sched_update_queues_state(&readyqueue, client);
+	}
+	else {
+		current_pcb->ipc_receiving = 1;
+		sched_update_queues_state(&ipc_waitqueue, current_pcb);
+		if (client) sched_switch_to(client);
+		else sched_switch_process();
+	}
+
+	copy_to_user(&current_pcb->ipc_msg, umsg, sizeof(struct ipc_msg));
+	return current_pcb->ipc_from;
+}
+
+/* The clients blocked on an exiting task get -ENSPID */
+void ipc_release(struct task_struct *t) {
+	struct list_head * pos;
+	struct task_struct * client;
+
+	while (!list_empty(&t->ipc_senders) || !list_empty(&t->ipc_replyqueue)) {
+		if (!list_empty(&t->ipc_senders)) pos = list_first(&t->ipc_senders);
+		else pos = list_first(&t->ipc_replyqueue);
+		list_del(pos);
+		client = list_head_to_task_struct(pos);
+		client->ipc_ret = -ENSPID;
+		sched_update_queues_state(&readyqueue, client);
+	}
+}
@@ -1,6 +1,7 @@
 #include <libc.h>
 #include <types.h>
 #include <errno.h>
+#include <timepage.h>
 
 void itoa(int a, char *b) {
 	int i, i1;
@@ -84,32 +85,19 @@ int read (int fd, char *buffer, int size) {
 	return ret;
 }
 
-/* Wrapper Syscall Gettime */
+/* Gettime without syscall: reads the time page */
 unsigned int gettime() {
-	int ret;
-	__asm__ volatile(
-		"mov %%r7, %1;"
-		"svc 0x0;"
-		"mov %0, %%r0;"
-		:"=r" (ret)
-		:"r"  (10)
-	 	:"r7"
-	);
-	return ret;
+	return time_page_user->clock;
 }
 
-/* Wrapper Syscall GetPid */
+/* Microseconds from the system timer, read from user mode (wraps every ~71 minutes) */
+unsigned int gettime_us() {
+	return *((volatile unsigned int *)TIME_STIMER_CLO);
+}
+
+/* GetPid without syscall: reads the time page */
 int getpid() {
-	int ret;
-	__asm__ volatile(
-		"mov %%r7, %1;"
-		"svc 0x0;"
-		"mov %0, %%r0;"
-		:"=r" (ret)
-		:"r"  (20)
-		:"r7"
-	);
-	return ret;
+	return time_page_user->pid;
 }
 
 /* Wrapper Syscall Fork */
@@ -177,6 +165,72 @@ int get_stats(int pid, struct stats *st) {
 	return ret;
 }
 
+/* Wrapper Syscall get_sys_stats */
+int get_sys_stats(struct sys_stats *st) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (st),
+		"r" (36)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall get_stats_v */
+int get_stats_v(int pid, unsigned int version, void *st) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r2, %3;"
+		"mov %%r7, %4;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (pid),
+		"r" (version),
+		"r" (st),
+		"r" (37)
+		:"r0", "r1", "r2", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall get_work_stats */
+int get_work_stats(int id, struct work_stats *st) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (id),
+		"r" (st),
+		"r" (38)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
 /* Wrapper Syscall clone */
 int clone (void (*function)(void), void *stack) {
 	int ret;
@@ -314,3 +368,657 @@ void change_led(int status) {
 	);
 }
 
+
+/* Wrapper Syscall set_priority */
+int set_priority(int pid, int prio) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (pid),
+		"r" (prio),
+		"r" (11)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall set_nice */
+int set_nice(int pid, int nice) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (pid),
+		"r" (nice),
+		"r" (12)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall set_deadline */
+int set_deadline(unsigned int period, unsigned int runtime, unsigned int deadline) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r2, %3;"
+		"mov %%r7, %4;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (period),
+		"r" (runtime),
+		"r" (deadline),
+		"r" (13)
+		:"r0", "r1", "r2", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall sleep_ms */
+int sleep_ms(unsigned int ms) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (ms),
+		"r" (16)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall sleep_until */
+int sleep_until(unsigned int deadline) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (deadline),
+		"r" (17)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall tcgetattr */
+int tcgetattr(int fd, struct termios *t) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (fd),
+		"r" (t),
+		"r" (6)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall tcsetattr */
+int tcsetattr(int fd, int actions, struct termios *t) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r2, %3;"
+		"mov %%r7, %4;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (fd),
+		"r" (actions),
+		"r" (t),
+		"r" (7)
+		:"r0", "r1", "r2", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall poll */
+int poll(struct pollfd *fds, unsigned int nfds, int timeout) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r2, %3;"
+		"mov %%r7, %4;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (fds),
+		"r" (nfds),
+		"r" (timeout),
+		"r" (8)
+		:"r0", "r1", "r2", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall open, returns a file descriptor */
+int open(const char *path, int flags) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (path),
+		"r" (flags),
+		"r" (26)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall close */
+int close(int fd) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (fd),
+		"r" (27)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall dup, returns the new file descriptor */
+int dup(int fd) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (fd),
+		"r" (28)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall lseek, returns the new offset */
+int lseek(int fd, int offset, int whence) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r2, %3;"
+		"mov %%r7, %4;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (fd),
+		"r" (offset),
+		"r" (whence),
+		"r" (29)
+		:"r0", "r1", "r2", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall mmap, returns the address of the mapping or MAP_FAILED */
+void *mmap(unsigned int length, int prot, int fd, unsigned int offset) {
+	void *ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r2, %3;"
+		"mov %%r3, %4;"
+		"mov %%r7, %5;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (length),
+		"r" (prot),
+		"r" (fd),
+		"r" (offset),
+		"r" (30)
+		:"r0", "r1", "r2", "r3", "r7"
+	);
+	if ((int)ret < 0) {
+		errno = -((int)ret);
+		ret = MAP_FAILED;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall munmap */
+int munmap(void *addr, unsigned int length) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (addr),
+		"r" (length),
+		"r" (31)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall pipe, 'fds[0]' is the read end and 'fds[1]' the write end */
+int pipe(int fds[2]) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (fds),
+		"r" (32)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall shm_create, shared memory region 'id' of 'size' bytes */
+int shm_create(int id, unsigned int size) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (id),
+		"r" (size),
+		"r" (33)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall shm_attach, returns the address of the region or (void *)-1 */
+void *shm_attach(int id) {
+	void *ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (id),
+		"r" (34)
+		:"r0", "r7"
+	);
+	if ((int)ret < 0) {
+		errno = -((int)ret);
+		ret = (void *)-1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall shm_detach */
+int shm_detach(void *addr) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (addr),
+		"r" (39)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall shm_remove */
+int shm_remove(int id) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r7, %2;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (id),
+		"r" (43)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall futex */
+int futex(int *uaddr, int op, int val) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r2, %3;"
+		"mov %%r7, %4;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (uaddr),
+		"r" (op),
+		"r" (val),
+		"r" (40)
+		:"r0", "r1", "r2", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* ARMv6 data memory barrier, orders the accesses around the lock word */
+#define dmb()	__asm__ __volatile__ ("mcr p15, 0, %0, c7, c10, 5;" : : "r" (0) : "memory")
+
+/* Sets '*p' to 'new' if it is 'old' (LDREX/STREX), returns the value found */
+static inline int atomic_cmpxchg(volatile int *p, int old, int new) {
+	int prev, fail;
+
+	do {
+		__asm__ __volatile__(
+			"ldrex %0, [%2];"
+			"mov %1, #0;"
+			"teq %0, %3;"
+			"strexeq %1, %4, [%2];"
+			: "=&r" (prev), "=&r" (fail)
+			: "r" (p), "r" (old), "r" (new)
+			: "cc", "memory"
+		);
+	} while (fail);
+	return prev;
+}
+
+/* Sets '*p' to 'new', returns the old value */
+static inline int atomic_xchg(volatile int *p, int new) {
+	int prev, fail;
+
+	do {
+		__asm__ __volatile__(
+			"ldrex %0, [%2];"
+			"strex %1, %3, [%2];"
+			: "=&r" (prev), "=&r" (fail)
+			: "r" (p), "r" (new)
+			: "memory"
+		);
+	} while (fail);
+	return prev;
+}
+
+/* Adds 'inc' to '*p', returns the old value */
+static inline int atomic_add(volatile int *p, int inc) {
+	int prev, tmp, fail;
+
+	do {
+		__asm__ __volatile__(
+			"ldrex %0, [%3];"
+			"add %1, %0, %4;"
+			"strex %2, %1, [%3];"
+			: "=&r" (prev), "=&r" (tmp), "=&r" (fail)
+			: "r" (p), "r" (inc)
+			: "memory"
+		);
+	} while (fail);
+	return prev;
+}
+
+void mutex_init(struct mutex *m) {
+	m->val = 0;
+}
+
+/* Uncontended: a single LDREX/STREX. Contended: marks the waiters (2) and sleeps. */
+void mutex_lock(struct mutex *m) {
+	int c = atomic_cmpxchg(&m->val, 0, 1);
+
+	if (c != 0) {
+		if (c != 2) c = atomic_xchg(&m->val, 2);
+		while (c != 0) {
+			futex((int *)&m->val, FUTEX_WAIT, 2);
+			c = atomic_xchg(&m->val, 2);
+		}
+	}
+	dmb();
+}
+
+/* 0 if the mutex was taken, -1 if it is locked */
+int mutex_trylock(struct mutex *m) {
+	if (atomic_cmpxchg(&m->val, 0, 1) != 0) return -1;
+	dmb();
+	return 0;
+}
+
+/* Enters the kernel only if there are waiters */
+void mutex_unlock(struct mutex *m) {
+	dmb();
+	if (atomic_xchg(&m->val, 0) == 2) futex((int *)&m->val, FUTEX_WAKE, 1);
+}
+
+void usem_init(struct usem *s, int value) {
+	s->value = value;
+	s->waiters = 0;
+}
+
+/* Takes a unit in user space, sleeps on the value while it is 0 */
+void usem_wait(struct usem *s) {
+	int v;
+
+	for (;;) {
+		v = s->value;
+		if (v > 0) {
+			if (atomic_cmpxchg(&s->value, v, v-1) == v) break;
+			continue;
+		}
+		atomic_add(&s->waiters, 1);
+		futex((int *)&s->value, FUTEX_WAIT, 0);
+		atomic_add(&s->waiters, -1);
+	}
+	dmb();
+}
+
+/* Enters the kernel only if there are waiters */
+void usem_post(struct usem *s) {
+	dmb();
+	atomic_add(&s->value, 1);
+	if (s->waiters > 0) futex((int *)&s->value, FUTEX_WAKE, 1);
+}
+
+/* Wrapper Syscall ipc_call, the reply overwrites 'msg' */
+int ipc_call(int pid, struct ipc_msg *msg) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (pid),
+		"r" (msg),
+		"r" (41)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall ipc_reply_wait, returns the PID of the client of the next request */
+int ipc_reply_wait(int reply_pid, struct ipc_msg *msg) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (reply_pid),
+		"r" (msg),
+		"r" (42)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall io_setup, returns the I/O ring of the task or NULL */
+struct io_ring *io_setup() {
+	struct io_ring *ret;
+	__asm__ volatile(
+		"mov %%r7, %1;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (18)
+		:"r0", "r7"
+	);
+	if ((int)ret < 0) {
+		errno = -((int)ret);
+		ret = NULL;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall io_enter */
+int io_enter(unsigned int to_submit, unsigned int min_complete) {
+	int ret;
+	__asm__ volatile(
+		"mov %%r0, %1;"
+		"mov %%r1, %2;"
+		"mov %%r7, %3;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r" (to_submit),
+		"r" (min_complete),
+		"r" (19)
+		:"r0", "r1", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
+
+/* Wrapper Syscall wait_period */
+int wait_period() {
+	int ret;
+	__asm__ volatile(
+		"mov %%r7, %1;"
+		"svc 0x0;"
+		"mov %0, %%r0;"
+		:"=r" (ret)
+		:"r"  (14)
+		:"r0", "r7"
+	);
+	if (ret < 0) {
+		errno = -ret;
+		ret = -1;
+	}
+	return ret;
+}
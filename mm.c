@@ -1,4 +1,5 @@
 #include <types.h>
+#include <errno.h>
 #include <mm.h>
 #include <hardware.h>
 #include <sched.h>
@@ -7,7 +8,7 @@
 #include <gpio.h>
 #include <io.h>
 
-/* Set/clear frame array */
+/* Reference counts of the frames */
 Byte phys_mem[TOTAL_PH_PAGES];
 
 /* PAGING */
@@ -31,6 +32,15 @@ unsigned int program_breaks[NR_TASKS];
 /* Counters for the references to a same program break */
 Byte pb_counter[NR_TASKS];
 
+/* ASID of each directory, tagged with the generation it was given in (upper bits).
+ * ASID 0 is never given, a directory with an old generation needs a new ASID. */
+unsigned int dir_asid[NR_TASKS];
+unsigned int asid_generation;
+unsigned int asid_next;
+/* Directory switches done without flushing the TLB and ASID rollovers (full flush) */
+unsigned int tlb_flushes_avoided;
+unsigned int asid_rollovers;
+
 #define CLEAR_PAGE empty_sl_ptable[0].entry
 
 /***********************************************/
@@ -48,6 +58,7 @@ void init_mm() {
 	init_table_pages();
 	init_dir_pages();
 	init_pb();
+	init_asid();
 
 
 	disable_icache();
@@ -62,16 +73,18 @@ void init_mm() {
 	);
 
 
-	/* 4. Enable the MMU by setting bit 0 in the CP15 Control Register in the corresponding world. */
+	/* 4. Enable the MMU by setting bit 0 in the CP15 Control Register in the corresponding world.
+	 * The D-cache (invalidated above), write buffer and branch prediction go with it. */
 	ctrl_reg creg;
-	__asm__ __volatile__ ("mcr P15, 0,  %0,  c1, c0, 0;" : "=r"(creg));
+	__asm__ __volatile__ ("mrc P15, 0,  %0,  c1, c0, 0;" : "=r"(creg));
 	creg.bits.XP = 1;
 	creg.bits.M = 1;
+	creg.bits.C = 1;
+	creg.bits.W = 1;
+	creg.bits.Z = 1;
 	__asm__ __volatile__ ("mcr P15, 0,  %0,  c1, c0, 0;" : : "r"(creg));
 
-	// invalidate both caches
-	__asm__ __volatile__ ("mcr P15, 0,  %0,  c7, c7, 0;" : : "r"(0));
-
+	icache_invalidate();
 	enable_icache();
 }
 
@@ -82,14 +95,14 @@ void set_empty_page(sl_page_table_entry * empty_page) {
 
     empty_page->bits.xn = 1;
     empty_page->bits.setbit = 1;
-    empty_page->bits.b = 0;
-    empty_page->bits.c = 0;
+    empty_page->bits.b = 1; // normal memory, write-back
+    empty_page->bits.c = 1;
 
     /* privileged == rw, user == rw */
     empty_page->bits.ap = 0b11;
     empty_page->bits.apx = 0;
     empty_page->bits.tex = 0;
-    empty_page->bits.s = 1;
+    empty_page->bits.s = 0;
     empty_page->bits.ng = 1;
 }
 
@@ -134,15 +147,15 @@ void init_table_pages() {
 
             sl_ptable[i][0][k].bits.xn = 0;
             sl_ptable[i][0][k].bits.setbit = 1;
-            sl_ptable[i][0][k].bits.b = 0;
-            sl_ptable[i][0][k].bits.c = 0;
+            sl_ptable[i][0][k].bits.b = 1; // normal memory, write-back
+            sl_ptable[i][0][k].bits.c = 1;
 
             /* privileged == rw, user == no access */
             sl_ptable[i][0][k].bits.ap = 0b01;
             sl_ptable[i][0][k].bits.apx = 0;
             sl_ptable[i][0][k].bits.tex = 0;
-            sl_ptable[i][0][k].bits.s = 1;
-            sl_ptable[i][0][k].bits.ng = 1; // global vs nonglobal (process specific)
+            sl_ptable[i][0][k].bits.s = 0; // the ARM1176 does not cache shared memory
+            sl_ptable[i][0][k].bits.ng = 0; // global: the same in every address space, kept on ASID switches
         }
     }
 }
@@ -255,14 +268,14 @@ void set_user_pages( struct task_struct *task ) {
 
 		process_PT[pag].bits.xn = 0;
 		process_PT[pag].bits.setbit = 1;
-		process_PT[pag].bits.b = 0;
-		process_PT[pag].bits.c = 0;
+		process_PT[pag].bits.b = 1;
+		process_PT[pag].bits.c = 1;
 
 		/* privileged == rw, user == r */
 		process_PT[pag].bits.ap = 0b10;
 		process_PT[pag].bits.apx = 0;
 		process_PT[pag].bits.tex = 0;
-		process_PT[pag].bits.s = 1;
+		process_PT[pag].bits.s = 0;
 		process_PT[pag].bits.ng = 1;
 	}
 
@@ -274,16 +287,17 @@ void set_user_pages( struct task_struct *task ) {
 
 		process_PT[pag].bits.xn = 1; // Not executable
 		process_PT[pag].bits.setbit = 1;
-		process_PT[pag].bits.b = 0;
-		process_PT[pag].bits.c = 0;
+		process_PT[pag].bits.b = 1;
+		process_PT[pag].bits.c = 1;
 
 		/* privileged == rw, user == rw */
 		process_PT[pag].bits.ap = 0b11;
 		process_PT[pag].bits.apx = 0;
 		process_PT[pag].bits.tex = 0;
-		process_PT[pag].bits.s = 1;
+		process_PT[pag].bits.s = 0;
 		process_PT[pag].bits.ng = 1;
 	}
+	dcache_clean_range(process_PT, (NUM_PAG_CODE+NUM_PAG_DATA)*sizeof(sl_page_table_entry));
 }
 
 /* Sets the page of the virtual address to the page of the ph address of the current
@@ -298,30 +312,190 @@ void set_vitual_to_phsycial(unsigned int virtual, unsigned ph, char to_current_t
 	else {
 		for (i=0; i< NR_TASKS; i++) {
 			sl_ptable[i][dir][page].bits.pbase_addr = (ph>>12);
+			/* Peripherals: strongly-ordered, never cached nor executed */
+			sl_ptable[i][dir][page].bits.tex = 0;
+			sl_ptable[i][dir][page].bits.c = 0;
+			sl_ptable[i][dir][page].bits.b = 0;
+			sl_ptable[i][dir][page].bits.xn = 1;
+			mmu_clean_pte(&sl_ptable[i][dir][page]);
 		}
 	}
-    asm volatile ("mcr p15, 0, %0, c7, c5,  4" :: "r" (0) : "memory");
-    asm volatile ("mcr p15, 0, %0, c7, c6,  0" :: "r" (0) : "memory");
+	/* Lines of the RAM that was mapped there must not be written back later */
+	dcache_clean_invalidate();
+	__asm__ __volatile__ (
+			"mcr P15, 0,  %0,  c8, c7, 0;" // invalidate tlb
+			"mcr P15, 0,  %0,  c7, c5, 4;" // flush prefetch buffer
+			:
+			: "r" (0) : "memory"
+	);
+}
+
+/* Maps the kernel page 'virtual' to the frame of 'ph' in all the tasks, readable (not
+ * writable nor executable) from user mode. 'device' maps it strongly-ordered (peripherals),
+ * otherwise it is normal cacheable memory. */
+void set_user_ro_page(unsigned int virtual, unsigned int ph, char device) {
+	int i;
+	unsigned int page = PAGE(virtual);
+
+	for (i=0; i< NR_TASKS; i++) {
+		sl_page_table_entry * pte = &sl_ptable[i][0][page];
+		pte->bits.pbase_addr = (ph>>12);
+		pte->bits.tex = 0;
+		pte->bits.c = device ? 0 : 1;
+		pte->bits.b = device ? 0 : 1;
+		pte->bits.xn = 1;
+		/* privileged == rw, user == r */
+		pte->bits.ap = 0b10;
+		pte->bits.apx = 0;
+		mmu_clean_pte(pte);
+	}
+	dcache_clean_invalidate();
 	__asm__ __volatile__ (
-			"mcr P15, 0,  %0,  c7, c7, 0;" // invalidate both caches
 			"mcr P15, 0,  %0,  c8, c7, 0;" // invalidate tlb
+			"mcr P15, 0,  %0,  c7, c5, 4;" // flush prefetch buffer
 			:
-			: "r" (0)
+			: "r" (0) : "memory"
 	);
 }
 
 /* Changes directory base and flushes TLB and d/i caches */
 void mmu_change_dir (fl_page_table_entry * dir) {
+	unsigned int asid = dir_get_asid(dir_index(dir));
 	__asm__ __volatile__ (
 			"mcr P15, 0,  %0,  c2, c0, 0;"	// TTB0
 			"mcr P15, 0,  %0,  c2, c0, 1;"	// TTB1
-			"mcr P15, 0,  %1,  c7, c7, 0;" // invalidate both caches
+			"mcr P15, 0,  %2, c13, c0, 1;"	// Context ID (ASID)
+			"mcr P15, 0,  %1,  c7, c14, 0;" // clean and invalidate d-cache
 			"mcr P15, 0,  %1,  c8, c7, 0;" // invalidate tlb
 			: /* no output */
-			: "r"(dir), "r" (0)
+			: "r"(dir), "r" (0), "r"(asid)
+	);
+	icache_invalidate();
+}
+
+/* Changes directory base and ASID. The TLB entries of the other address spaces are
+ * tagged with their own ASID, so nothing has to be flushed. TTB0 and the ASID can not
+ * change at once: the reserved ASID 0 (never given, no non-global entries) is set while
+ * TTB0 changes, so no table walk caches an entry of one space with the ASID of the other. */
+void mmu_switch_dir (fl_page_table_entry * dir) {
+	unsigned int gen = asid_generation;
+	unsigned int asid = dir_get_asid(dir_index(dir));
+	__asm__ __volatile__ (
+			"mcr P15, 0,  %1,  c7, c5, 6;"	// flush branch target cache
+			"mcr P15, 0,  %1,  c7, c10, 4;"	// drain write buffer
+			"mcr P15, 0,  %1, c13, c0, 1;"	// Context ID (reserved ASID 0)
+			"mcr P15, 0,  %1,  c7, c5, 4;"	// flush prefetch buffer
+			"mcr P15, 0,  %0,  c2, c0, 0;"	// TTB0
+			"mcr P15, 0,  %1,  c7, c5, 4;"	// flush prefetch buffer
+			"mcr P15, 0,  %2, c13, c0, 1;"	// Context ID (ASID)
+			"mcr P15, 0,  %1,  c7, c5, 4;"	// flush prefetch buffer
+			: /* no output */
+			: "r"(dir), "r" (0), "r"(asid)
+	);
+	if (gen == asid_generation) ++tlb_flushes_avoided;
+}
+
+/* Invalidates the TLB entries of an address space after changing its page table */
+void mmu_flush_tlb (fl_page_table_entry * dir) {
+	int i = dir_index(dir);
+
+	/* Without an ASID of this generation it can not have TLB entries */
+	if ((dir_asid[i]&~ASID_MASK) != asid_generation) return;
+	__asm__ __volatile__ (
+			"mcr P15, 0,  %0,  c7, c10, 4;"	// drain write buffer
+			"mcr P15, 0,  %1,  c8, c7, 2;"	// invalidate tlb entries of the ASID
+			: /* no output */
+			: "r"(0), "r"(dir_asid[i]&ASID_MASK)
+	);
+}
+
+/***********************************************/
+/*************** CACHE MAINTENANCE *************/
+/***********************************************/
+
+/* Writes back the D-cache lines of a memory range (write buffer drained) */
+void dcache_clean_range(void *start, unsigned int size) {
+	unsigned int addr = ((unsigned int)start)&~(CACHE_LINE_SIZE-1);
+	unsigned int end = (unsigned int)start + size;
+
+	for (; addr < end; addr += CACHE_LINE_SIZE) {
+		__asm__ __volatile__ ("mcr P15, 0,  %0,  c7, c10, 1;" : : "r"(addr) : "memory");
+	}
+	__asm__ __volatile__ ("mcr P15, 0,  %0,  c7, c10, 4;" : : "r"(0) : "memory");
+}
+
+/* Writes back and invalidates the whole D-cache */
+void dcache_clean_invalidate() {
+	__asm__ __volatile__ (
+			"mcr P15, 0,  %0,  c7, c14, 0;" // clean and invalidate d-cache
+			"mcr P15, 0,  %0,  c7, c10, 4;" // drain write buffer
+			: : "r"(0) : "memory"
+	);
+}
+
+/* Invalidates the I-cache and the branch target cache. ARM1176 erratum 411920:
+ * the invalidate has to be issued four times, followed by 11 nops */
+void icache_invalidate() {
+	__asm__ __volatile__ (
+			"mcr P15, 0,  %0,  c7, c5, 0;"
+			"mcr P15, 0,  %0,  c7, c5, 0;"
+			"mcr P15, 0,  %0,  c7, c5, 0;"
+			"mcr P15, 0,  %0,  c7, c5, 0;"
+			"mcr P15, 0,  %0,  c7, c5, 6;" // flush branch target cache
+			"nop; nop; nop; nop; nop; nop; nop; nop; nop; nop; nop;"
+			: : "r"(0) : "memory"
 	);
 }
 
+/* The page table walks do not look into the D-cache, a modified entry has to be in memory */
+void mmu_clean_pte(sl_page_table_entry * pte) {
+	dcache_clean_range(pte, sizeof(sl_page_table_entry));
+}
+
+/* Makes the code written through the D-cache visible to the instruction fetches */
+void sync_code_range(void *start, unsigned int size) {
+	dcache_clean_range(start, size);
+	icache_invalidate();
+}
+
+/***********************************************/
+/**************** ASID MANAGEMENT **************/
+/***********************************************/
+
+/* Initializes the ASID allocator, no directory has an ASID yet */
+void init_asid() {
+	int i;
+
+	for (i = 0; i < NR_TASKS; i++) dir_asid[i] = 0;
+	asid_generation = 1<<ASID_BITS;
+	asid_next = 1;
+	tlb_flushes_avoided = 0;
+	asid_rollovers = 0;
+}
+
+/* Index on fl_ptable of a directory */
+int dir_index (fl_page_table_entry * dir) {
+	return (dir - &fl_ptable[0][0])/TOTAL_DIR_ENTRIES;
+}
+
+/* Returns the ASID of the directory, giving it a new one if it has none in the current
+ * generation. When the ASIDs run out a new generation starts: the whole TLB is flushed
+ * and every directory will get a new ASID when it is used again. */
+unsigned int dir_get_asid (int i) {
+	if ((dir_asid[i]&~ASID_MASK) != asid_generation) {
+		if (asid_next > ASID_MASK) {
+			asid_generation += 1<<ASID_BITS;
+			if (asid_generation == 0) asid_generation = 1<<ASID_BITS;
+			asid_next = 1;
+			++asid_rollovers;
+			__asm__ __volatile__ ("mcr P15, 0,  %0,  c8, c7, 0;" : : "r"(0)); // invalidate tlb
+		}
+		dir_asid[i] = asid_generation|asid_next;
+		++asid_next;
+	}
+	return dir_asid[i]&ASID_MASK;
+}
+
 /* allocate_page_dir - Assignates a dir page to a task_struct and initializes its reference counter */
 void allocate_page_dir (struct task_struct *p) {
 	int i;
@@ -333,6 +507,7 @@ void allocate_page_dir (struct task_struct *p) {
 	p->dir_pages_baseAddr = (fl_page_table_entry *)&fl_ptable[i][ENTRY_DIR_PAGES];
 	p->dir_count = &assigned_base_dir[i];
 	assigned_base_dir[i] = 1;
+	dir_asid[i] = 0; /* A new address space, the TLB entries of the last user are not valid */
 }
 
 /* Assignates a program_break and its counter to the task given */
@@ -394,14 +569,20 @@ void free_user_pages( struct task_struct *task ) {
 			free_frame(process_PT[pag].bits.pbase_addr);
 			process_PT[pag].entry = CLEAR_PAGE;
 		}
+		dcache_clean_range(process_PT, TOTAL_PAGES_ENTRIES*sizeof(sl_page_table_entry));
 	}
 }
 
-/* free_frame - Mark as FREE_FRAME the frame  'frame'.*/
+/* free_frame - Drops a reference to the frame 'frame', the last one marks it as FREE_FRAME */
 void free_frame( unsigned int frame ) {
-    /* You must insert code here */
-	if ((frame>NUM_PAG_KERNEL)&&(frame<TOTAL_PH_PAGES))
-		phys_mem[frame]=FREE_FRAME;
+	if ((frame>NUM_PAG_KERNEL)&&(frame<TOTAL_PH_PAGES)&&(phys_mem[frame]!=FREE_FRAME))
+		--phys_mem[frame];
+}
+
+/* ref_frame - Takes another reference to the used frame 'frame' (a new mapping of it) */
+void ref_frame( unsigned int frame ) {
+	if ((frame>NUM_PAG_KERNEL)&&(frame<TOTAL_PH_PAGES)&&(phys_mem[frame]!=FREE_FRAME))
+		++phys_mem[frame];
 }
 
 /* set_ss_pag - Associates logical page 'page' with physical page 'frame' */
@@ -410,20 +591,103 @@ void set_ss_pag(sl_page_table_entry *PT, unsigned page,unsigned frame) {
 	PT[page].bits.pbase_addr=frame;
 	PT[page].bits.xn = 1; // Not executable
 	PT[page].bits.setbit = 1;
-	PT[page].bits.b = 0;
-	PT[page].bits.c = 0;
+	PT[page].bits.b = 1; // normal memory, write-back
+	PT[page].bits.c = 1;
 
     /* privileged == rw, user == rw */
 	PT[page].bits.ap = 0b11;
 	PT[page].bits.apx = 0;
 	PT[page].bits.tex = 0;
-  	PT[page].bits.s = 1;
+  	PT[page].bits.s = 0;
   	PT[page].bits.ng = 1;
+	mmu_clean_pte(&PT[page]);
+}
+
+/* set_ss_pag_ro - Associates logical page 'page' with 'frame', read-only from user mode */
+void set_ss_pag_ro(sl_page_table_entry *PT, unsigned page,unsigned frame) {
+	set_ss_pag(PT, page, frame);
+	/* privileged == rw, user == r */
+	PT[page].bits.ap = 0b10;
+	mmu_clean_pte(&PT[page]);
 }
 
 /* del_ss_pag - Removes mapping from logical page 'logical_page' */
 void del_ss_pag(sl_page_table_entry *PT, unsigned logical_page) {
   PT[logical_page].entry=CLEAR_PAGE;
+  mmu_clean_pte(&PT[logical_page]);
+}
+
+/* kmap - Maps 'frame' at the kernel window (KMAP_ADDR) of the current directory and returns
+ * its address. The window is private to the kernel and only valid until the next kmap. */
+void * kmap(unsigned int frame) {
+	sl_page_table_entry * pte = &get_PT(current(),0)[PAGE(KMAP_ADDR)];
+
+	pte->entry = 0;
+	pte->bits.pbase_addr = frame;
+	pte->bits.xn = 1;
+	pte->bits.setbit = 1;
+	pte->bits.b = 1;
+	pte->bits.c = 1;
+	/* privileged == rw, user == no access */
+	pte->bits.ap = 0b01;
+	pte->bits.apx = 0;
+	mmu_clean_pte(pte);
+	__asm__ __volatile__ (
+			"mcr P15, 0,  %0,  c8, c7, 1;" // invalidate tlb entry by MVA
+			"mcr P15, 0,  %1,  c7, c5, 4;" // flush prefetch buffer
+			:
+			: "r" (KMAP_ADDR), "r" (0) : "memory"
+	);
+	return (void *)KMAP_ADDR;
+}
+
+/* Copies between the kernel and the user space of 'task', that may not be the current one.
+ * 'to_task' selects the direction. Returns -ENACCB if a page of the range is not mapped. */
+static int copy_task(struct task_struct *task, void *kernel, void *user, int size, char to_task) {
+	sl_page_table_entry * pt = get_PT(task,1);
+	unsigned int addr = (unsigned int)user;
+	Byte * page;
+	int n;
+
+	while (size > 0) {
+		if (DIR(addr) != 1 || !check_used_page(&pt[PAGE(addr)])) return -ENACCB;
+		n = PAGE_SIZE - OFFSET(addr);
+		if (n > size) n = size;
+
+		if (get_DIR(task) == get_DIR(current())) page = (Byte *)(addr - OFFSET(addr));
+		else page = kmap(pt[PAGE(addr)].bits.pbase_addr);
+
+		if (to_task) copy_data(kernel, page + OFFSET(addr), n);
+		else copy_data(page + OFFSET(addr), kernel, n);
+
+		kernel = (Byte *)kernel + n;
+		addr += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/* copy_to_task - Copies 'size' bytes from kernel 'start' to the user address 'dest' of 'task' */
+int copy_to_task(struct task_struct *task, void *start, void *dest, int size) {
+	return copy_task(task, start, dest, size, 1);
+}
+
+/* copy_from_task - Copies 'size' bytes from the user address 'start' of 'task' to kernel 'dest' */
+int copy_from_task(struct task_struct *task, void *start, void *dest, int size) {
+	return copy_task(task, dest, start, size, 0);
+}
+
+/* mmap_region_alloc - First page of a run of 'npages' free pages of the mmap region,
+ * -ENOMEM if there is none */
+int mmap_region_alloc(sl_page_table_entry *PT, unsigned int npages) {
+	unsigned int pag, n = 0, first = 0;
+
+	for (pag = MMAP_FIRST_PAG_D1; pag < IORING_FIRST_PAG_D1 && n < npages; pag++) {
+		if (check_used_page(&PT[pag])) n = 0;
+		else if (n++ == 0) first = pag;
+	}
+	if (n < npages) return -ENOMEM;
+	return first;
 }
 
 /* get_frame - Returns the physical frame associated to page 'logical_page' */
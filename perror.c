@@ -21,11 +21,22 @@ char *sys_errlist[] = {
 /*	ESDEST 14 	*/ "Blocked in a destroyed semaphore",
 /*	ESNOWN 15 	*/ "Not the owner of the semaphore",
 /*	ENOMEM 16 	*/ "Not enough free memory in the heap",
-/*	EHLIMI 17  	*/ "Heap limit reached"
+/*	EHLIMI 17  	*/ "Heap limit reached",
+/*	EINVAL 18  	*/ "Invalid argument",
+/*	ENOSCH 19  	*/ "Real-time task set would not be schedulable",
+/*	ENOENT 20  	*/ "No such file or device",
+/*	EMFILE 21  	*/ "Too many open files in the task",
+/*	ENFILE 22  	*/ "Too many open files in the system",
+/*	ESPIPE 23  	*/ "Illegal seek",
+/*	EFBIG 24  	*/ "File too large",
+/*	ENOSPC 25  	*/ "No space left on the filesystem",
+/*	EPIPE 26  	*/ "Broken pipe",
+/*	EEXIST 27  	*/ "Already exists",
+/*	EAGAIN 28  	*/ "Try again"
 // Afegir coma al penultim element, i incrementar el max
 };
 
-int sys_nerr = 17; // Max number
+int sys_nerr = 28; // Max number
 
 void perror(char *s) {
 	char *cp = sys_errlist[errno];
@@ -0,0 +1,230 @@
+#include <pipe.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mm.h>
+#include <pollwait.h>
+#include <sched.h>
+#include <utils.h>
+
+static struct pipe pipes[NR_PIPES];
+
+unsigned int pipe_bytes;
+unsigned int pipe_pages_moved;
+unsigned int pipe_read_blocks;
+unsigned int pipe_write_blocks;
+
+#define PIPE_SLOT(pos)	(((pos) >> OFFSET_BITS) & (PIPE_PAGES-1))
+
+/* Wakes up all the tasks of 'queue', they check the pipe again */
+static void pipe_wake(struct list_head *queue) {
+	struct list_head * task_list;
+
+	while (!list_empty(queue)) {
+		task_list = list_first(queue);
+		list_del(task_list);
+		sched_update_queues_state(&readyqueue, list_head_to_task_struct(task_list));
+	}
+}
+
+/* The reader gets the frame of the whole page at the tail of the ring in place of the
+ * frame of its page 'addr' (data or heap), the ring keeps the old one. 0 if 'addr' is
+ * not a page of the task that can be moved. */
+static int pipe_move_page(struct pipe *p, unsigned int addr) {
+	sl_page_table_entry * pt = get_PT(current(),1);
+	unsigned int pag = PAGE(addr), slot = PIPE_SLOT(p->tail);
+	unsigned int frame;
+
+	if (DIR(addr) != 1 || pag < INIT_USR_DATA_PAG_D1 || pag >= MMAP_FIRST_PAG_D1) return 0;
+	if (!check_used_page(&pt[pag])) return 0;
+
+	frame = get_frame(pt, pag);
+	set_ss_pag(pt, pag, p->frames[slot]);
+	p->frames[slot] = frame;
+	mmu_flush_tlb(get_DIR(current()));
+	return 1;
+}
+
+/* Blocks until there is data or the write end is closed (end of file). Whole pages
+ * going to page aligned buffers are moved instead of copied. */
+static int pipe_read(struct file *f, char *buffer, int size) {
+	struct pipe * p = f->private_data;
+	unsigned int off, n, avail, addr;
+	int done = 0;
+
+	while (p->head == p->tail) {
+		if (p->writers == 0) return 0;
+		++pipe_read_blocks;
+		sched_update_queues_state(&p->readqueue, current());
+		sched_switch_process();
+	}
+
+	while (done < size && p->head != p->tail) {
+		avail = p->head - p->tail;
+		off = OFFSET(p->tail);
+		addr = (unsigned int)buffer + done;
+
+		if (off == 0 && avail >= PAGE_SIZE && size - done >= PAGE_SIZE
+				&& OFFSET(addr) == 0 && pipe_move_page(p, addr)) {
+			n = PAGE_SIZE;
+			++pipe_pages_moved;
+		}
+		else {
+			n = PAGE_SIZE - off;
+			if (n > avail) n = avail;
+			if (n > size - done) n = size - done;
+			copy_to_user((char *)kmap(p->frames[PIPE_SLOT(p->tail)]) + off, buffer + done, n);
+		}
+		done += n;
+		p->tail += n;
+	}
+
+	pipe_bytes += done;
+	pipe_wake(&p->writequeue);
+	poll_wake(&p->pollers);
+	return done;
+}
+
+/* Blocks until all the bytes are in the ring. -EPIPE if the read end is closed. */
+static int pipe_write(struct file *f, char *buffer, int size) {
+	struct pipe * p = f->private_data;
+	unsigned int off, n, space;
+	int done = 0;
+
+	while (done < size) {
+		if (p->readers == 0) return done ? done : -EPIPE;
+
+		space = PIPE_SIZE - (p->head - p->tail);
+		if (space == 0) {
+			/* The readers take what is already written */
+			pipe_wake(&p->readqueue);
+			poll_wake(&p->pollers);
+			++pipe_write_blocks;
+			sched_update_queues_state(&p->writequeue, current());
+			sched_switch_process();
+			continue;
+		}
+
+		off = OFFSET(p->head);
+		n = PAGE_SIZE - off;
+		if (n > space) n = space;
+		if (n > size - done) n = size - done;
+		copy_from_user(buffer + done, (char *)kmap(p->frames[PIPE_SLOT(p->head)]) + off, n);
+		done += n;
+		p->head += n;
+	}
+
+	pipe_wake(&p->readqueue);
+	poll_wake(&p->pollers);
+	return done;
+}
+
+/* A closed end counts as ready: reads return end of file, writes -EPIPE */
+static short pipe_poll(struct file *f, short events, struct poll_table *pt) {
+	struct pipe * p = f->private_data;
+	short revents = 0;
+
+	poll_wait(pt, &p->pollers);
+	if ((events & POLLIN) && file_readable(f)) {
+		if (p->head != p->tail || p->writers == 0) revents |= POLLIN;
+	}
+	if ((events & POLLOUT) && file_writable(f)) {
+		if (p->head - p->tail < PIPE_SIZE || p->readers == 0) revents |= POLLOUT;
+	}
+	return revents;
+}
+
+static void pipe_free_frames(struct pipe *p) {
+	int i;
+
+	for (i = 0; i < PIPE_PAGES; i++) free_frame(p->frames[i]);
+}
+
+/* Last reference to an end, the pipe is freed with the second one */
+static void pipe_release(struct file *f) {
+	struct pipe * p = f->private_data;
+
+	if (file_readable(f)) p->readers = 0;
+	else p->writers = 0;
+
+	/* The tasks blocked on the other end see the close */
+	pipe_wake(&p->readqueue);
+	pipe_wake(&p->writequeue);
+	poll_wake(&p->pollers);
+
+	if (p->readers == 0 && p->writers == 0) pipe_free_frames(p);
+}
+
+struct file_operations pipe_fops = {
+	.read = pipe_read,
+	.write = pipe_write,
+	.poll = pipe_poll,
+	.release = pipe_release,
+};
+
+/* Syscall pipe, 'ufds[0]' is the read end and 'ufds[1]' the write end */
+int sys_pipe(int *ufds) {
+	struct task_struct * current_pcb = current();
+	struct pipe * p = NULL;
+	struct file * f[2];
+	int fds[2], i, frame;
+
+	if (ufds == NULL) return -EPNULL;
+	if (access_ok(VERIFY_WRITE, ufds, 2*sizeof(int)) == 0) return -ENACCB;
+
+	for (i = 0; i < NR_PIPES && p == NULL; i++) {
+		if (pipes[i].readers == 0 && pipes[i].writers == 0) p = &pipes[i];
+	}
+	if (p == NULL) return -ENFILE;
+
+	for (i = 0; i < PIPE_PAGES; i++) {
+		frame = alloc_frame();
+		if (frame == -1) {
+			while (i != 0) free_frame(p->frames[--i]); // rollback
+			return -ENMPHP;
+		}
+		p->frames[i] = frame;
+	}
+
+	f[0] = file_alloc(&pipe_fops, O_RDONLY);
+	f[1] = file_alloc(&pipe_fops, O_WRONLY);
+	fds[0] = fd_alloc(current_pcb);
+	if (fds[0] >= 0) current_pcb->fds[fds[0]] = f[0];
+	fds[1] = fd_alloc(current_pcb);
+
+	if (f[0] == NULL || f[1] == NULL || fds[0] < 0 || fds[1] < 0) {
+		/* Back to the free entries, nothing was opened */
+		if (fds[0] >= 0) current_pcb->fds[fds[0]] = NULL;
+		if (f[0] != NULL) f[0]->count = 0;
+		if (f[1] != NULL) f[1]->count = 0;
+		pipe_free_frames(p);
+		return (f[0] == NULL || f[1] == NULL) ? -ENFILE : -EMFILE;
+	}
+	current_pcb->fds[fds[1]] = f[1];
+
+	p->head = 0;
+	p->tail = 0;
+	p->readers = 1;
+	p->writers = 1;
+	INIT_LIST_HEAD(&p->readqueue);
+	INIT_LIST_HEAD(&p->writequeue);
+	INIT_LIST_HEAD(&p->pollers);
+	f[0]->private_data = p;
+	f[1]->private_data = p;
+
+	copy_to_user(fds, ufds, 2*sizeof(int));
+	return 0;
+}
+
+/* All the pipes are free */
+void init_pipes() {
+	int i;
+
+	for (i = 0; i < NR_PIPES; i++) {
+		pipes[i].readers = 0;
+		pipes[i].writers = 0;
+	}
+	pipe_bytes = 0;
+	pipe_pages_moved = 0;
+	pipe_read_blocks = 0;
+	pipe_write_blocks = 0;
+}
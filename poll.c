@@ -0,0 +1,121 @@
+#include <pollwait.h>
+#include <errno.h>
+#include <file.h>
+#include <mm_address.h>
+#include <sched.h>
+#include <timer.h>
+#include <utils.h>
+
+/* Tasks blocked in 'poll' */
+static LIST_HEAD(pollqueue);
+
+static void poll_wake_frame(struct poll_frame *frame) {
+	if (frame->woken) return;
+	frame->woken = 1;
+	list_del(&frame->task->list);
+	sched_update_queues_state(&readyqueue, frame->task);
+}
+
+/* A source became ready: wakes up the tasks polling it (interrupts disabled) */
+void poll_wake(struct list_head *pollers) {
+	struct list_head * pos;
+	struct poll_entry * entry;
+
+	list_for_each(pos, pollers) {
+		entry = list_entry(pos, struct poll_entry, list);
+		entry->fired = 1;
+		poll_wake_frame(entry->frame);
+	}
+}
+
+/* Called by a poll operation: the pollfd being checked waits on 'wq' */
+void poll_wait(struct poll_table *pt, struct list_head *wq) {
+	struct poll_entry * entry;
+
+	if (pt->frame == NULL || pt->n == POLL_ENTRIES) return;
+
+	entry = &pt->entries[pt->n++];
+	entry->frame = pt->frame;
+	entry->index = pt->index;
+	entry->fired = 0;
+	list_add_tail(&entry->list, wq);
+}
+
+static void poll_timeout(struct ktimer *t) {
+	struct poll_frame * frame = t->data;
+
+	frame->timed_out = 1;
+	poll_wake_frame(frame);
+}
+
+/* Readiness of a source, its waiter lists are added to 'pt' */
+static short poll_check(struct pollfd *pfd, struct poll_table *pt) {
+	struct file * f;
+
+	if (pfd->fd >= POLL_SEM_BASE && pfd->fd < POLL_SEM_BASE+SEM_SIZE) return sem_poll(pfd->fd - POLL_SEM_BASE, pfd->events, pt);
+
+	f = file_get(current(), pfd->fd);
+	if (f == NULL) return POLLNVAL;
+	if (f->ops->poll == NULL) return pfd->events & (POLLIN|POLLOUT);
+	return f->ops->poll(f, pfd->events, pt);
+}
+
+/* Syscall poll, waits until one of the sources is ready or 'timeout' ms have passed
+ * (-1 forever, 0 does not block). Returns the number of sources with revents. */
+int sys_poll(struct pollfd *ufds, unsigned int nfds, int timeout) {
+	struct pollfd fds[POLL_MAX];
+	struct poll_entry entries[POLL_ENTRIES];
+	struct poll_table pt;
+	struct poll_frame frame;
+	int i, ready = 0;
+
+	if (nfds > POLL_MAX) return -EINVAL;
+	/* poll(NULL, 0, ms) only sleeps */
+	if (nfds > 0) {
+		if (ufds == NULL) return -EPNULL;
+		if (access_ok(VERIFY_WRITE, ufds, nfds*sizeof(struct pollfd)) == 0) return -ENACCB;
+		copy_from_user(ufds, fds, nfds*sizeof(struct pollfd));
+	}
+
+	frame.task = current();
+	frame.woken = 0;
+	frame.timed_out = 0;
+	pt.frame = (timeout != 0) ? &frame : NULL;
+	pt.entries = entries;
+	pt.n = 0;
+
+	for (i = 0; i < nfds; i++) {
+		pt.index = i;
+		fds[i].revents = poll_check(&fds[i], &pt);
+		if (fds[i].revents) ++ready;
+	}
+
+	if (ready == 0 && timeout != 0) {
+		init_ktimer(&frame.timer, poll_timeout, &frame);
+		if (timeout > 0) ktimer_add(&frame.timer, clock_get_time() + timeout + 1);
+
+		/* The lists are already registered */
+		pt.frame = NULL;
+		while (ready == 0 && !frame.timed_out) {
+			sched_update_queues_state(&pollqueue, frame.task);
+			sched_switch_process();
+			frame.woken = 0;
+
+			/* Only the sources that woke us up */
+			for (i = 0; i < pt.n; i++) {
+				if (!entries[i].fired) continue;
+				entries[i].fired = 0;
+				fds[entries[i].index].revents = poll_check(&fds[entries[i].index], &pt);
+			}
+			for (i = 0; i < nfds; i++) {
+				if (fds[i].revents) ++ready;
+			}
+		}
+		ktimer_del(&frame.timer);
+	}
+
+	for (i = 0; i < pt.n; i++) list_del(&entries[i].list);
+
+	if (nfds > 0) copy_to_user(fds, ufds, nfds*sizeof(struct pollfd));
+	return ready;
+}
@@ -0,0 +1,169 @@
+#include <ramfs.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mm.h>
+#include <sched.h>
+#include <utils.h>
+
+/* Files of the filesystem, a flat directory ("/<name>") */
+static struct ramfs_inode ramfs_inodes[RAMFS_FILES];
+
+static int ramfs_name_equal(char *a, char *b) {
+	while (*a && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+/* Frame of the page 'pag' of 'inode', a hole gets a zeroed frame.
+ * -ENMPHP if there are no free frames. */
+static int ramfs_get_frame(struct ramfs_inode *inode, unsigned int pag) {
+	unsigned int * page;
+	int frame, i;
+
+	if (inode->frames[pag] != 0) return inode->frames[pag];
+
+	frame = alloc_frame();
+	if (frame == -1) return -ENMPHP;
+	page = kmap(frame);
+	for (i = 0; i < PAGE_SIZE/sizeof(unsigned int); i++) page[i] = 0;
+	inode->frames[pag] = frame;
+	return frame;
+}
+
+/* Looks up the file 'name', O_CREAT creates it if it does not exist */
+static int ramfs_open(struct file *f, char *name, int flags) {
+	struct ramfs_inode * inode, * free = NULL;
+	int i;
+
+	if (name[0] != '/' || name[1] == '\0') return -ENOENT;
+	name++;
+	for (i = 0; name[i] != '\0'; i++) {
+		if (name[i] == '/') return -ENOENT;
+	}
+
+	for (i = 0; i < RAMFS_FILES; i++) {
+		inode = &ramfs_inodes[i];
+		if (!inode->used) {
+			if (free == NULL) free = inode;
+		}
+		else if (ramfs_name_equal(inode->name, name)) {
+			f->private_data = inode;
+			return 0;
+		}
+	}
+
+	if (!(flags & O_CREAT)) return -ENOENT;
+	if (free == NULL) return -ENOSPC;
+
+	for (i = 0; name[i] != '\0'; i++) free->name[i] = name[i];
+	free->name[i] = '\0';
+	free->size = 0;
+	for (i = 0; i < RAMFS_FILE_PAGES; i++) free->frames[i] = 0;
+	free->used = 1;
+	f->private_data = free;
+	return 0;
+}
+
+/* Copies from the file to the user through the kmap window, the holes read as zeros */
+static int ramfs_read(struct file *f, char *buffer, int size) {
+	struct ramfs_inode * inode = f->private_data;
+	unsigned int pag, off, n, i;
+	int done = 0;
+
+	if (f->pos >= inode->size) return 0;
+	if (size > inode->size - f->pos) size = inode->size - f->pos;
+
+	while (done < size) {
+		pag = f->pos >> OFFSET_BITS;
+		off = OFFSET(f->pos);
+		n = PAGE_SIZE - off;
+		if (n > size - done) n = size - done;
+
+		if (inode->frames[pag] == 0) {
+			for (i = 0; i < n; i++) buffer[done+i] = 0;
+		}
+		else copy_to_user((char *)kmap(inode->frames[pag]) + off, buffer + done, n);
+
+		done += n;
+		f->pos += n;
+	}
+	return done;
+}
+
+/* Copies from the user to the file, allocating the frames of the pages written */
+static int ramfs_write(struct file *f, char *buffer, int size) {
+	struct ramfs_inode * inode = f->private_data;
+	unsigned int pag, off, n;
+	int frame, done = 0;
+
+	if (f->pos >= RAMFS_MAX_SIZE) return -EFBIG;
+	if (size > RAMFS_MAX_SIZE - f->pos) size = RAMFS_MAX_SIZE - f->pos;
+
+	while (done < size) {
+		pag = f->pos >> OFFSET_BITS;
+		off = OFFSET(f->pos);
+		n = PAGE_SIZE - off;
+		if (n > size - done) n = size - done;
+
+		frame = ramfs_get_frame(inode, pag);
+		if (frame < 0) {
+			if (done == 0) return frame;
+			break;
+		}
+		copy_from_user(buffer + done, (char *)kmap(frame) + off, n);
+
+		done += n;
+		f->pos += n;
+	}
+	if (f->pos > inode->size) inode->size = f->pos;
+	return done;
+}
+
+/* Moves the offset of the open file, it can go past the end (a later write leaves a hole) */
+static int ramfs_lseek(struct file *f, int offset, int whence) {
+	struct ramfs_inode * inode = f->private_data;
+	int base;
+
+	switch (whence) {
+		case SEEK_SET:
+			base = 0;
+			break;
+		case SEEK_CUR:
+			base = f->pos;
+			break;
+		case SEEK_END:
+			base = inode->size;
+			break;
+		default:
+			return -EINVAL;
+	}
+	if (base + offset < 0) return -EINVAL;
+
+	f->pos = base + offset;
+	return f->pos;
+}
+
+/* Frame of the page 'pgoff' to map, only the pages with data of the file */
+static int ramfs_mmap(struct file *f, unsigned int pgoff) {
+	struct ramfs_inode * inode = f->private_data;
+
+	if (pgoff >= RAMFS_FILE_PAGES || (pgoff << OFFSET_BITS) >= inode->size) return -EINVAL;
+	return ramfs_get_frame(inode, pgoff);
+}
+
+struct file_operations ramfs_fops = {
+	.open = ramfs_open,
+	.read = ramfs_read,
+	.write = ramfs_write,
+	.lseek = ramfs_lseek,
+	.mmap = ramfs_mmap,
+};
+
+/* Empty filesystem */
+void init_ramfs() {
+	int i;
+
+	for (i = 0; i < RAMFS_FILES; i++) ramfs_inodes[i].used = 0;
+}
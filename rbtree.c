@@ -0,0 +1,226 @@
+#include <rbtree.h>
+
+#define NULL_NODE ((struct rb_node *) 0)
+
+/* Left rotation around 'node' */
+static void rb_rotate_left(struct rb_node *node, struct rb_root *root) {
+	struct rb_node *right = node->right;
+
+	node->right = right->left;
+	if (right->left) right->left->parent = node;
+	right->parent = node->parent;
+
+	if (!node->parent) root->node = right;
+	else if (node == node->parent->left) node->parent->left = right;
+	else node->parent->right = right;
+
+	right->left = node;
+	node->parent = right;
+}
+
+/* Right rotation around 'node' */
+static void rb_rotate_right(struct rb_node *node, struct rb_root *root) {
+	struct rb_node *left = node->left;
+
+	node->left = left->right;
+	if (left->right) left->right->parent = node;
+	left->parent = node->parent;
+
+	if (!node->parent) root->node = left;
+	else if (node == node->parent->right) node->parent->right = left;
+	else node->parent->left = left;
+
+	left->right = node;
+	node->parent = left;
+}
+
+/* Rebalances the tree after linking 'node' with rb_link_node */
+void rb_insert_color(struct rb_node *node, struct rb_root *root) {
+	struct rb_node *parent, *gparent, *uncle, *tmp;
+
+	while ((parent = node->parent) && parent->color == RB_RED) {
+		gparent = parent->parent;
+
+		if (parent == gparent->left) {
+			uncle = gparent->right;
+			if (uncle && uncle->color == RB_RED) {
+				uncle->color = RB_BLACK;
+				parent->color = RB_BLACK;
+				gparent->color = RB_RED;
+				node = gparent;
+				continue;
+			}
+			if (parent->right == node) {
+				rb_rotate_left(parent, root);
+				tmp = parent; parent = node; node = tmp;
+			}
+			parent->color = RB_BLACK;
+			gparent->color = RB_RED;
+			rb_rotate_right(gparent, root);
+		}
+		else {
+			uncle = gparent->left;
+			if (uncle && uncle->color == RB_RED) {
+				uncle->color = RB_BLACK;
+				parent->color = RB_BLACK;
+				gparent->color = RB_RED;
+				node = gparent;
+				continue;
+			}
+			if (parent->left == node) {
+				rb_rotate_right(parent, root);
+				tmp = parent; parent = node; node = tmp;
+			}
+			parent->color = RB_BLACK;
+			gparent->color = RB_RED;
+			rb_rotate_left(gparent, root);
+		}
+	}
+
+	root->node->color = RB_BLACK;
+}
+
+/* Restores the black height after removing a black node. 'node' (may be NULL)
+ * took the place of the removed one below 'parent' */
+static void rb_erase_color(struct rb_node *node, struct rb_node *parent, struct rb_root *root) {
+	struct rb_node *other;
+
+	while ((!node || node->color == RB_BLACK) && node != root->node) {
+		if (parent->left == node) {
+			other = parent->right;
+			if (other->color == RB_RED) {
+				other->color = RB_BLACK;
+				parent->color = RB_RED;
+				rb_rotate_left(parent, root);
+				other = parent->right;
+			}
+			if ((!other->left || other->left->color == RB_BLACK) &&
+				(!other->right || other->right->color == RB_BLACK)) {
+				other->color = RB_RED;
+				node = parent;
+				parent = node->parent;
+			}
+			else {
+				if (!other->right || other->right->color == RB_BLACK) {
+					other->left->color = RB_BLACK;
+					other->color = RB_RED;
+					rb_rotate_right(other, root);
+					other = parent->right;
+				}
+				other->color = parent->color;
+				parent->color = RB_BLACK;
+				other->right->color = RB_BLACK;
+				rb_rotate_left(parent, root);
+				node = root->node;
+				break;
+			}
+		}
+		else {
+			other = parent->left;
+			if (other->color == RB_RED) {
+				other->color = RB_BLACK;
+				parent->color = RB_RED;
+				rb_rotate_right(parent, root);
+				other = parent->left;
+			}
+			if ((!other->left || other->left->color == RB_BLACK) &&
+				(!other->right || other->right->color == RB_BLACK)) {
+				other->color = RB_RED;
+				node = parent;
+				parent = node->parent;
+			}
+			else {
+				if (!other->left || other->left->color == RB_BLACK) {
+					other->right->color = RB_BLACK;
+					other->color = RB_RED;
+					rb_rotate_left(other, root);
+					other = parent->left;
+				}
+				other->color = parent->color;
+				parent->color = RB_BLACK;
+				other->left->color = RB_BLACK;
+				rb_rotate_right(parent, root);
+				node = root->node;
+				break;
+			}
+		}
+	}
+
+	if (node) node->color = RB_BLACK;
+}
+
+/* Removes 'node' from the tree */
+void rb_erase(struct rb_node *node, struct rb_root *root) {
+	struct rb_node *child, *parent, *old, *left;
+	int color;
+
+	if (!node->left) child = node->right;
+	else if (!node->right) child = node->left;
+	else {
+		/* Two children: the successor takes the place of the node */
+		old = node;
+		node = node->right;
+		while ((left = node->left) != NULL_NODE) node = left;
+
+		if (old->parent) {
+			if (old->parent->left == old) old->parent->left = node;
+			else old->parent->right = node;
+		}
+		else root->node = node;
+
+		child = node->right;
+		parent = node->parent;
+		color = node->color;
+
+		if (parent == old) parent = node;
+		else {
+			if (child) child->parent = parent;
+			parent->left = child;
+			node->right = old->right;
+			old->right->parent = node;
+		}
+
+		node->parent = old->parent;
+		node->color = old->color;
+		node->left = old->left;
+		old->left->parent = node;
+
+		if (color == RB_BLACK) rb_erase_color(child, parent, root);
+		return;
+	}
+
+	parent = node->parent;
+	color = node->color;
+
+	if (child) child->parent = parent;
+	if (parent) {
+		if (parent->left == node) parent->left = child;
+		else parent->right = child;
+	}
+	else root->node = child;
+
+	if (color == RB_BLACK) rb_erase_color(child, parent, root);
+}
+
+/* Returns the leftmost (smallest) node of the tree, NULL if it is empty */
+struct rb_node *rb_first(const struct rb_root *root) {
+	struct rb_node *node = root->node;
+
+	if (!node) return NULL_NODE;
+	while (node->left) node = node->left;
+	return node;
+}
+
+/* Returns the in-order successor of 'node', NULL if it is the last one */
+struct rb_node *rb_next(const struct rb_node *node) {
+	struct rb_node *parent;
+
+	if (node->right) {
+		node = node->right;
+		while (node->left) node = node->left;
+		return (struct rb_node *) node;
+	}
+
+	while ((parent = node->parent) && node == parent->right) node = parent;
+	return parent;
+}
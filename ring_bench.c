@@ -0,0 +1,93 @@
+/*
+ * Host benchmark of the SPSC ring (include/ring.h): 'make ring_bench && ./ring_bench'.
+ * A producer thread and a consumer thread move the same bytes through a ring,
+ * one element per call and then in bulk, and check the order of the data.
+ * A side that finds the ring full/empty yields, the host may have a single CPU.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Quoted: include/ also has a sched.h of the kernel */
+#include "ring.h"
+
+#define RING_SIZE	1024
+#define TOTAL		(16*1024*1024)	/* Bytes moved per run */
+
+static char ring_buffer[RING_SIZE];
+static struct ring r;
+static unsigned int chunk; /* Elements per call, 1 uses ring_put/ring_get */
+static int errors;
+
+static void *producer(void *arg) {
+	unsigned char data[RING_SIZE];
+	unsigned int i, n, sent = 0;
+
+	while (sent < TOTAL) {
+		n = (TOTAL - sent < chunk) ? TOTAL - sent : chunk;
+		for (i = 0; i < n; i++) data[i] = (unsigned char)(sent + i);
+
+		if (chunk == 1) {
+			while (!ring_put(&r, data)) sched_yield();
+		}
+		else {
+			for (i = 0; i < n; ) {
+				if (ring_full(&r)) sched_yield();
+				i += ring_write_n(&r, data + i, n - i);
+			}
+		}
+		sent += n;
+	}
+	return NULL;
+}
+
+static void *consumer(void *arg) {
+	unsigned char data[RING_SIZE];
+	unsigned int i, n, received = 0;
+
+	while (received < TOTAL) {
+		if (chunk == 1) n = ring_get(&r, data);
+		else n = ring_read_n(&r, data, chunk);
+
+		if (n == 0) sched_yield();
+		for (i = 0; i < n; i++) {
+			if (data[i] != (unsigned char)(received + i)) ++errors;
+		}
+		received += n;
+	}
+	return NULL;
+}
+
+static double run(unsigned int elems) {
+	pthread_t prod, cons;
+	struct timespec start, end;
+
+	chunk = elems;
+	ring_init(&r, ring_buffer, 1, RING_SIZE);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_create(&cons, NULL, consumer, NULL);
+	pthread_create(&prod, NULL, producer, NULL);
+	pthread_join(prod, NULL);
+	pthread_join(cons, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(void) {
+	unsigned int sizes[] = { 1, 16, 64, 256, 1024 };
+	unsigned int i;
+	double secs;
+
+	printf("%8s %10s %12s\n", "chunk", "seconds", "MB/s");
+	for (i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+		secs = run(sizes[i]);
+		printf("%8u %10.3f %12.1f\n", sizes[i], secs, TOTAL / secs / (1024*1024));
+	}
+
+	if (errors) printf("%d bytes out of order\n", errors);
+	return errors != 0;
+}
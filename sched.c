@@ -1,9 +1,18 @@
 #include <sched.h>
+#include <asm.h>
+#include <stddef.h>
+#include <errno.h>
 #include <mm.h>
 #include <io.h>
 #include <sem.h>
 #include <hardware.h>
 #include <system.h>
+#include <timer.h>
+#include <utils.h>
+
+/* Fails to compile if the entry stubs and struct task_struct disagree */
+typedef char task_user_lr_check[(offsetof(struct task_struct, user_lr) == TASK_USER_LR
+		&& offsetof(struct task_struct, user_sp) == TASK_USER_LR-4) ? 1 : -1];
 
 union task_union task[NR_TASKS] __attribute__((__section__(".data.task")));
 struct task_struct * idle_task;
@@ -11,6 +20,64 @@ struct task_struct * idle_task;
 struct list_head freequeue;
 struct list_head readyqueue;
 struct list_head keyboardqueue;
+struct list_head sleepqueue;
+
+/* Tasks alive, hashed by PID */
+struct list_head pid_hash[PIDHASH_SIZE];
+
+/* Priority scheduler: one ready queue per level and a bitmap of the non-empty ones */
+struct list_head prio_queue[NR_PRIO];
+unsigned int prio_bitmap;
+
+/* Fair scheduler: ready tasks sorted by vruntime and the sum of their weights */
+struct rb_root cfs_timeline;
+unsigned int cfs_load;
+unsigned int cfs_min_vruntime;
+
+/* MLFQ: one ready queue per level (0 is the top one) and the count of priority boosts */
+struct list_head mlfq_queue[MLFQ_LEVELS];
+unsigned int mlfq_boosts;
+unsigned int mlfq_boost_ticks;
+
+/* EDF: ready real-time tasks sorted by deadline, tasks waiting for their next release,
+ * every real-time task and the CPU reserved by them (per mille) */
+struct list_head edf_readyqueue;
+struct list_head edf_periodqueue;
+struct list_head edf_tasks;
+unsigned int edf_utilization;
+
+/* Policy below the EDF class */
+static void (* edf_next_update_data)();
+static int (* edf_next_change_needed)();
+static void (* edf_next_switch_process)();
+static void (* edf_next_update_queues_state)(struct list_head* ls, struct task_struct * task);
+
+/* Weight of each nice value (-20..19), every step is ~10% of CPU */
+static const unsigned int nice_to_weight[NICE_MAX-NICE_MIN+1] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	 9548,  7620,  6100,  4904,  3906,
+	 3121,  2501,  1991,  1586,  1277,
+	 1024,   820,   655,   526,   423,
+	  335,   272,   215,   172,   137,
+	  110,    87,    70,    56,    45,
+	   36,    29,    23,    18,    15,
+};
+
+/* 2^32/weight: the tick charge is a multiply and a shift, ARMv6 has no divide */
+static const unsigned int nice_to_wmult[NICE_MAX-NICE_MIN+1] = {
+	    48388,     59856,     76040,     92818,    118348,
+	   147320,    184698,    229616,    287308,    360437,
+	   449829,    563644,    704093,    875809,   1099582,
+	  1376151,   1717300,   2157191,   2708050,   3363326,
+	  4194304,   5237765,   6557202,   8165337,  10153587,
+	 12820798,  15790321,  19976592,  24970740,  31350126,
+	 39045157,  49367440,  61356676,  76695845,  95443718,
+	119304647, 148102321, 186737709, 238609294, 286331153,
+};
+
+/* vruntime comparison that survives the wrap around of the counter */
+#define vruntime_before(a,b)	((int)((a)-(b)) < 0)
 
 int lastPID;
 unsigned int rr_quantum;
@@ -25,44 +92,60 @@ sl_page_table_entry * get_PT (struct task_struct *t, unsigned char dir_entry) {
 	return (sl_page_table_entry *)(((unsigned int)(t->dir_pages_baseAddr[dir_entry].bits.pbase_addr))<<10);
 }
 
-/* Idle task function */
+/* Idle task function. The CPU sleeps (WFI) with the periodic tick stopped until the
+ * next event the scheduler needs the timer for, or any other interrupt. */
 void cpu_idle() {
 	asm volatile("cpsie i, #0x13;"); // enable irq on SYS
-	while(1);
+	while(1) {
+		asm volatile("cpsid i;");
+		tick_stop(sched_next_event());
+		asm volatile("mcr p15, 0, %0, c7, c0, 4;" : : "r"(0)); // wait for interrupt
+		asm volatile("cpsie i;");
+	}
 }
 
-/* Get task_struct of the process from the queue with the especified PID  */
-int getStructPID(int PID, struct list_head * queue, struct task_struct ** pointer_to_desired) {
-	int found = 0;
+/* Ticks until the next timer driven event (release of a real-time job, kernel timer) */
+unsigned int sched_next_event() {
+	struct list_head *pos;
+	unsigned int now = clock_get_time();
+	unsigned int next = timer_next_event();
 
-	if (current()->PID == PID) {
-		*pointer_to_desired = current();
-		found = 1;
+	list_for_each(pos, &edf_periodqueue) {
+		int ticks = (int)(list_head_to_task_struct(pos)->edf.release - now);
+		if (ticks <= 0) return 1;
+		if ((unsigned int)ticks < next) next = ticks;
 	}
 
-	if (!list_empty(queue) && (found == 0)) {
-		struct list_head *first = list_first(queue);
-		if (list_head_to_task_struct(first)->PID == PID) {
-			found = 1;
-			*pointer_to_desired = list_head_to_task_struct(first);
-		}
-		else {
-			list_del(queue);
-			list_add_tail(first, queue);
-		}
+	return next;
+}
 
-		while(first != list_first(queue)) {
-			struct list_head *act = list_first(queue);
-			if (list_head_to_task_struct(act)->PID == PID) {
-				found = 1;
-				*pointer_to_desired = list_head_to_task_struct(act);
-			}
-			list_del(queue);
-			list_add_tail(act, queue);
-		}
+/* Init PID hash table */
+void init_pidhash() {
+	int i;
+
+	for (i = 0; i < PIDHASH_SIZE; i++) INIT_LIST_HEAD(&pid_hash[i]);
+}
+
+/* Makes the task reachable by its PID */
+void pid_hash_add(struct task_struct * t) {
+	list_add(&t->pid_list, &pid_hash[pid_hashfn(t->PID)]);
+}
+
+/* Removes the task from the PID hash table */
+void pid_hash_del(struct task_struct * t) {
+	list_del(&t->pid_list);
+}
+
+/* Get task_struct of the process with the especified PID, whatever its state. NULL if it does not exist */
+struct task_struct * find_task_by_pid(int PID) {
+	struct list_head *pos;
+
+	list_for_each(pos, &pid_hash[pid_hashfn(PID)]) {
+		struct task_struct * t = list_entry(pos, struct task_struct, pid_list);
+		if (t->PID == PID) return t;
 	}
 
-	return found;
+	return NULL;
 }
 
 /* Init freequeue */
@@ -85,6 +168,11 @@ void init_keyboardqueue () {
 	INIT_LIST_HEAD(&keyboardqueue);
 }
 
+/* Init sleepqueue */
+void init_sleepqueue () {
+	INIT_LIST_HEAD(&sleepqueue);
+}
+
 /* Init Semaphores */
 void init_semarray() {
 	int i;
@@ -93,11 +181,13 @@ void init_semarray() {
 		sem_array[i].id = i;
 		sem_array[i].pid_owner = -1;
 		sem_array[i].value = 0;
+		INIT_LIST_HEAD(&sem_array[i].pollers);
 	}
 }
 
 /* Idle task initialization */
 void init_idle () {	
+	int i;
 	struct list_head *idle_list_pointer = list_first(&freequeue);
 	list_del(idle_list_pointer);
 	idle_task = list_head_to_task_struct(idle_list_pointer);
@@ -105,6 +195,7 @@ void init_idle () {
 	allocate_page_dir(idle_task);
 
 	idle_task->PID = 0;
+	pid_hash_add(idle_task);
 	idle_union_stack->task.kernel_sp = (unsigned long)&idle_union_stack->stack[KERNEL_STACK_SIZE-1];
 	idle_union_stack->task.kernel_lr = (unsigned long)&cpu_idle;
 
@@ -112,11 +203,23 @@ void init_idle () {
 	idle_task->statistics.cs = 0;
 	idle_task->statistics.tics = 0;
 	idle_task->statistics.remaining_quantum = 0;
+	idle_task->statistics.priority = 0;
+	idle_task->statistics.nice = 0;
+	idle_task->statistics.vruntime = 0;
+	idle_task->statistics.deadline_misses = 0;
+	idle_task->edf.period = 0;
+	idle_task->statistics.level = 0;
+	for (i = 0; i < MLFQ_LEVELS; i++) idle_task->statistics.level_tics[i] = 0;
+	init_sched_hist(idle_task);
+	files_init(idle_task);
+	ipc_init(idle_task);
+	idle_task->kthread_fn = NULL;
 	idle_task->process_state = ST_READY;
 }
 
 /* Task1 initialization */
 void init_task1() {
+	int i;
 	struct list_head *task1_list_pointer = list_first(&freequeue);
 	list_del(task1_list_pointer);
 	struct task_struct * task1_task_struct = list_head_to_task_struct(task1_list_pointer);
@@ -125,6 +228,8 @@ void init_task1() {
 
 	task1_task_struct->PID = 1;
 	lastPID = 1;
+	time_page.tp.pid = 1;
+	pid_hash_add(task1_task_struct);
 	set_user_pages(task1_task_struct);
 	mmu_change_dir(dir_task1);
 
@@ -134,12 +239,100 @@ void init_task1() {
 	task1_task_struct->statistics.cs = 0;
 	task1_task_struct->statistics.tics = 0;
 	task1_task_struct->statistics.remaining_quantum = DEFAULT_RR_QUANTUM;
+	task1_task_struct->statistics.priority = DEFAULT_PRIO;
+	task1_task_struct->statistics.nice = 0;
+	task1_task_struct->statistics.vruntime = 0;
+	task1_task_struct->statistics.deadline_misses = 0;
+	task1_task_struct->edf.period = 0;
+	task1_task_struct->statistics.level = 0;
+	for (i = 0; i < MLFQ_LEVELS; i++) task1_task_struct->statistics.level_tics[i] = 0;
+	init_sched_hist(task1_task_struct);
+	vfp_init_state(&task1_task_struct->vfp);
+	open_console(task1_task_struct);
+	ipc_init(task1_task_struct);
+	task1_task_struct->kthread_fn = NULL;
 	task1_task_struct->process_state = ST_RUN;
 }
 
+/* First code run by a kernel thread (IRQs disabled) */
+static void kthread_start() {
+	struct task_struct * t = current();
+
+	t->kthread_fn(t->kthread_arg);
+	kthread_exit();
+}
+
+/* Creates a kernel thread: a task that runs 'fn' in kernel mode and never returns to user
+ * mode. It uses the directory of the idle task, only kernel pages are needed. Returns
+ * NULL if there is no free task_struct. */
+struct task_struct * kthread_create(void (*fn)(void *), void * arg) {
+	int i;
+	struct list_head *kthread_list_pointer;
+	struct task_struct * t;
+	union task_union * kthread_union;
+
+	if (list_empty(&freequeue)) return NULL;
+	kthread_list_pointer = list_first(&freequeue);
+	list_del(kthread_list_pointer);
+	t = list_head_to_task_struct(kthread_list_pointer);
+	kthread_union = (union task_union*)t;
+
+	t->dir_pages_baseAddr = idle_task->dir_pages_baseAddr;
+	t->dir_count = idle_task->dir_count;
+	*(t->dir_count) += 1;
+	t->kernel_sp = (unsigned long)&kthread_union->stack[KERNEL_STACK_SIZE-1];
+	t->kernel_lr = (unsigned long)&kthread_start;
+	t->user_sp = 0;
+	t->user_lr = 0;
+	t->kthread_fn = fn;
+	t->kthread_arg = arg;
+
+	/* Stats initialization */
+	t->statistics.cs = 0;
+	t->statistics.tics = 0;
+	t->statistics.remaining_quantum = DEFAULT_RR_QUANTUM;
+	t->statistics.priority = KTHREAD_PRIO;
+	t->statistics.nice = 0;
+	t->statistics.vruntime = cfs_min_vruntime;
+	t->statistics.deadline_misses = 0;
+	t->edf.period = 0;
+	t->statistics.level = 0;
+	t->mlfq_boost = 0;
+	for (i = 0; i < MLFQ_LEVELS; i++) t->statistics.level_tics[i] = 0;
+	init_sched_hist(t);
+	files_init(t);
+	ipc_init(t);
+
+	/* It enters the scheduler as a woken up task */
+	getNewPID(t);
+	t->process_state = ST_BLOCKED;
+	sched_update_queues_state(&readyqueue, t);
+	return t;
+}
+
+/* Ends the current kernel thread */
+void kthread_exit() {
+	struct task_struct * t = current();
+
+	*(t->dir_count) -= 1;
+	pid_hash_del(t);
+
+	sched_update_queues_state(&freequeue, t);
+	sched_switch_process();
+}
+
 /* Init scheduler */
 void init_sched() {
+#if SCHED_POLICY == SCHED_POLICY_PRIO
+	init_Sched_PRIO();
+#elif SCHED_POLICY == SCHED_POLICY_CFS
+	init_Sched_CFS();
+#elif SCHED_POLICY == SCHED_POLICY_MLFQ
+	init_Sched_MLFQ();
+#else
 	init_Sched_RR();
+#endif
+	init_Sched_EDF();
 }
 
 /* Task switch wrapper */
@@ -154,17 +347,35 @@ void task_switch_wrapper(union task_union *new) {
 	__asm__ __volatile__("ldmfd sp!, {r0-r12};");
 }
 
+/* Target of the dummy STREX of task_switch */
+static unsigned int strex_scratch;
+
 /* Task switch */
 void task_switch(union task_union *new, unsigned int last_sp) {
-	unsigned int last_lr;
+	unsigned int last_lr, strex_status;
 	__asm__ __volatile__ ("mov %0, lr" : "=r"(last_lr));
 	
 	struct task_struct * current_pcb = current();
 	fl_page_table_entry * dir_new = get_DIR((struct task_struct *) new);
 	fl_page_table_entry * dir_current = get_DIR(current_pcb);
 
-	/* Change directory base and flushes TLB except for threads */	
-	if (dir_new != dir_current) mmu_change_dir(dir_new);
+	/* Change directory base and ASID, threads share the directory */
+	if (dir_new != dir_current) mmu_switch_dir(dir_new);
+
+	/* VFP registers are switched lazily, on the first use */
+	vfp_task_switch((struct task_struct *) new);
+
+	/* getpid() of the user tasks reads the time page */
+	time_page.tp.pid = new->task.PID;
+
+	/* A LDREX of the old task (libc mutexes) must not pair with a STREX of the new one.
+	 * ARMv6 has no CLREX (ARMv6K), a STREX clears the local monitor too. */
+	__asm__ __volatile__ (
+			"strex	%0, %1, [%2];"
+			: "=&r"(strex_status)
+			: "r"(0), "r"(&strex_scratch)
+			: "memory"
+	);
 
 	/* Save the kernel/user state. (User saved when entered to the kernel) */	
 	current_pcb->kernel_sp = last_sp;
@@ -186,9 +397,11 @@ void task_switch(union task_union *new, unsigned int last_sp) {
 	);
 }
 
-/* Return new PID */
-int getNewPID() {
-	return ++lastPID;
+/* Assigns a new PID to the task and makes it reachable by find_task_by_pid */
+int getNewPID(struct task_struct * t) {
+	t->PID = ++lastPID;
+	pid_hash_add(t);
+	return t->PID;
 }
 
 /* Returns the task_struct at the head of the list */
@@ -208,6 +421,76 @@ struct task_struct* current() {
 
 /* SCHEDULER */
 
+/* log2 histogram bucket of a time in us */
+static unsigned int hist_bucket(unsigned int us) {
+	unsigned int zeros;
+
+	if (us < 2) return 0;
+	__asm__ __volatile__ ("clz %0, %1;" : "=r"(zeros) : "r"(us));
+	if (31-zeros >= HIST_BUCKETS) return HIST_BUCKETS-1;
+	return 31-zeros;
+}
+
+/* Adds a sample to a latency histogram */
+static void hist_add(unsigned int * hist, unsigned int * max, unsigned int us) {
+	++hist[hist_bucket(us)];
+	if (us > *max) *max = us;
+}
+
+/* Clears the latency histograms of a new task */
+void init_sched_hist(struct task_struct * task) {
+	int i;
+
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		task->hist.wakeup[i] = 0;
+		task->hist.run[i] = 0;
+	}
+	task->hist.wakeup_max = 0;
+	task->hist.run_max = 0;
+	task->ready_ts = timer_get_us();
+	task->run_ts = task->ready_ts;
+}
+
+/* Timestamps a task that becomes READY, its wakeup latency is measured from here */
+static inline void sched_stats_ready(struct task_struct * task) {
+	task->ready_ts = timer_get_us();
+}
+
+/* Gives the CPU to the task selected by the policy. The state of the current task is
+ * only touched if it is still running, blocked/dead tasks keep the state set by
+ * sched_update_queues_state. */
+void sched_task_switch(struct task_struct * task) {
+	struct task_struct * current_task = current();
+
+	unsigned int now;
+
+	task->process_state = ST_RUN;
+	if (task != current_task) {
+		now = timer_get_us();
+		hist_add(current_task->hist.run, &current_task->hist.run_max, now - current_task->run_ts);
+		if (task != idle_task) hist_add(task->hist.wakeup, &task->hist.wakeup_max, now - task->ready_ts);
+		task->run_ts = now;
+
+		++task->statistics.cs;
+		if (current_task->process_state == ST_RUN) current_task->process_state = ST_READY;
+		task_switch_wrapper((union task_union*)task);
+	}
+}
+
+/* Direct switch to the blocked task 'task' (removed from its queue), the current one
+ * must be already blocked. The policy is not asked: 'task' runs on the rest of the
+ * quantum of the current task, and the fair scheduler does not give it credit for the
+ * time it was blocked. */
+void sched_switch_to(struct task_struct * task) {
+	struct task_struct * current_task = current();
+
+	task->statistics.remaining_quantum = current_task->statistics.remaining_quantum;
+	if (vruntime_before(task->statistics.vruntime, current_task->statistics.vruntime))
+		task->statistics.vruntime = current_task->statistics.vruntime;
+	sched_stats_ready(task);
+	sched_task_switch(task);
+}
+
 /* Initialize RR scheduler */
 void init_Sched_RR() {
 	/* Scheduler RR selected*/
@@ -241,12 +524,7 @@ void sched_switch_process_RR() {
 	struct list_head *task_list;
 	struct task_struct * task;
 
-	if (!circularbIsEmpty(&uart_read_buffer) && !list_empty(&keyboardqueue)) {
-		task_list = list_first(&keyboardqueue);
-		list_del(task_list);
-		task = list_head_to_task_struct(task_list);
-	}
-	else if (!list_empty(&readyqueue)) {
+	if (!list_empty(&readyqueue)) {
 		task_list = list_first(&readyqueue);
 		list_del(task_list);
 		task = list_head_to_task_struct(task_list);
@@ -255,23 +533,567 @@ void sched_switch_process_RR() {
 
 	task->statistics.remaining_quantum = DEFAULT_RR_QUANTUM;
 	rr_quantum = DEFAULT_RR_QUANTUM;
-	if (task != current()) {
-		++task->statistics.cs;
-		task->process_state = ST_RUN;
-		current()->process_state = ST_READY;
-		task_switch_wrapper((union task_union*)task);
-	}
+	sched_task_switch(task);
 }
 
 /* Update queues state RR scheduler */
 void sched_update_queues_state_RR(struct list_head* ls, struct task_struct * task) {
 	if (ls == &freequeue) task->process_state = ST_ZOMBIE;
-	else if (ls == &readyqueue) task->process_state = ST_READY;
-	else if (ls == &keyboardqueue) task->process_state = ST_BLOCKED;
+	else if (ls == &readyqueue) {
+		task->process_state = ST_READY;
+		sched_stats_ready(task);
+	}
 	else task->process_state = ST_BLOCKED;
 
+	if (task != idle_task) list_add_tail(&task->list,ls);
+}
+
+/* PRIORITY SCHEDULER */
+
+/* Returns the highest priority level with ready tasks, -1 if there is none */
+static inline int prio_highest() {
+	unsigned int zeros;
+	__asm__ __volatile__ ("clz %0, %1;" : "=r"(zeros) : "r"(prio_bitmap));
+	return 31 - (int)zeros;
+}
+
+/* Removes a ready task from its priority queue */
+static void prio_dequeue(struct task_struct * task) {
+	unsigned int prio = task->statistics.priority;
+
+	list_del(&task->list);
+	if (list_empty(&prio_queue[prio])) prio_bitmap &= ~(1<<prio);
+}
+
+/* Initialize priority scheduler */
+void init_Sched_PRIO() {
+	int i;
+
+	sched_update_data = sched_update_data_PRIO;
+	sched_change_needed = sched_change_needed_PRIO;
+	sched_switch_process = sched_switch_process_PRIO;
+	sched_update_queues_state = sched_update_queues_state_PRIO;
+
+	for (i = 0; i < NR_PRIO; i++) INIT_LIST_HEAD(&prio_queue[i]);
+	prio_bitmap = 0;
+
+	struct task_struct * current_task = current();
+	current_task->statistics.remaining_quantum = DEFAULT_RR_QUANTUM;
+	current_task->statistics.priority = DEFAULT_PRIO;
+	current_task->process_state = ST_READY;
+}
+
+/* Update priority scheduler data */
+void sched_update_data_PRIO() {
+	struct task_struct * current_task = current();
+
+	if (current_task->statistics.remaining_quantum > 0) --(current_task->statistics.remaining_quantum);
+	++(current_task->statistics.tics);
+}
+
+/* Priority scheduler check: quantum expired or a more urgent task is ready */
+int sched_change_needed_PRIO() {
+	struct task_struct * current_task = current();
+
+	if (current_task == idle_task) return prio_bitmap != 0;
+	if (current_task->statistics.remaining_quantum == 0) return 1;
+	return prio_highest() > (int)current_task->statistics.priority;
+}
+
+/* Task switch priority scheduler. Same priority tasks are served round robin */
+void sched_switch_process_PRIO() {
+	struct task_struct * task;
+	int prio;
+
+	prio = prio_highest();
+	if (prio >= 0) {
+		task = list_head_to_task_struct(list_first(&prio_queue[prio]));
+		prio_dequeue(task);
+	}
+	else task = idle_task;
+
+	task->statistics.remaining_quantum = DEFAULT_RR_QUANTUM;
+	sched_task_switch(task);
+}
+
+/* Update queues state priority scheduler. Only the ready queue is split by level */
+void sched_update_queues_state_PRIO(struct list_head* ls, struct task_struct * task) {
+	if (ls != &readyqueue) {
+		sched_update_queues_state_RR(ls, task);
+		return;
+	}
+
+	task->process_state = ST_READY;
+	sched_stats_ready(task);
 	if (task != idle_task) {
-		if (ls == &keyboardqueue && task->kbinfo.keysread != 0) list_add(&task->list,ls);
-		else list_add_tail(&task->list,ls);
+		list_add_tail(&task->list, &prio_queue[task->statistics.priority]);
+		prio_bitmap |= 1<<task->statistics.priority;
+	}
+}
+
+/* Changes the priority of a task. A ready task is moved to the queue of its new level */
+void sched_set_priority(struct task_struct * task, int prio) {
+#if SCHED_POLICY == SCHED_POLICY_PRIO
+	if (task->process_state == ST_READY && task != idle_task && task->edf.period == 0) {
+		prio_dequeue(task);
+		task->statistics.priority = prio;
+		sched_update_queues_state(&readyqueue, task);
+		return;
+	}
+#endif
+	task->statistics.priority = prio;
+}
+
+/* COMPLETELY FAIR SCHEDULER */
+
+/* Weight of a task */
+static inline unsigned int cfs_weight(struct task_struct * task) {
+	return nice_to_weight[task->statistics.nice-NICE_MIN];
+}
+
+/* Inserts a task on the timeline, equal keys go to the right (FIFO) */
+static void cfs_enqueue(struct task_struct * task) {
+	struct rb_node **link = &cfs_timeline.node;
+	struct rb_node *parent = 0;
+	unsigned int key = task->statistics.vruntime;
+
+	while (*link) {
+		parent = *link;
+		if (vruntime_before(key, rb_entry(parent, struct task_struct, run_node)->statistics.vruntime))
+			link = &parent->left;
+		else link = &parent->right;
+	}
+
+	rb_link_node(&task->run_node, parent, link);
+	rb_insert_color(&task->run_node, &cfs_timeline);
+	cfs_load += cfs_weight(task);
+}
+
+/* Removes a task from the timeline */
+static void cfs_dequeue(struct task_struct * task) {
+	rb_erase(&task->run_node, &cfs_timeline);
+	cfs_load -= cfs_weight(task);
+}
+
+/* Ready task with the smallest vruntime, NULL if there is none */
+static inline struct task_struct * cfs_leftmost() {
+	struct rb_node *node = rb_first(&cfs_timeline);
+	return node ? rb_entry(node, struct task_struct, run_node) : 0;
+}
+
+/* min_vruntime only moves forward, it follows the smallest vruntime of the runnable tasks */
+static void cfs_update_min_vruntime() {
+	struct task_struct * current_task = current();
+	struct task_struct * leftmost = cfs_leftmost();
+	unsigned int vruntime = cfs_min_vruntime;
+
+	if (current_task != idle_task) vruntime = current_task->statistics.vruntime;
+	if (leftmost && (current_task == idle_task || vruntime_before(leftmost->statistics.vruntime, vruntime)))
+		vruntime = leftmost->statistics.vruntime;
+	if (vruntime_before(cfs_min_vruntime, vruntime)) cfs_min_vruntime = vruntime;
+}
+
+/* Initialize fair scheduler */
+void init_Sched_CFS() {
+	sched_update_data = sched_update_data_CFS;
+	sched_change_needed = sched_change_needed_CFS;
+	sched_switch_process = sched_switch_process_CFS;
+	sched_update_queues_state = sched_update_queues_state_CFS;
+
+	INIT_RB_ROOT(&cfs_timeline);
+	cfs_load = 0;
+	cfs_min_vruntime = 0;
+
+	struct task_struct * current_task = current();
+	current_task->statistics.remaining_quantum = CFS_LATENCY;
+	current_task->statistics.nice = 0;
+	current_task->statistics.vruntime = 0;
+	current_task->process_state = ST_READY;
+}
+
+/* Update fair scheduler data, charges the tick to the running task weighted by its nice */
+void sched_update_data_CFS() {
+	struct task_struct * current_task = current();
+
+	++(current_task->statistics.tics);
+	if (current_task == idle_task) return;
+
+	current_task->statistics.vruntime += ((unsigned long long)(1000*NICE_0_LOAD) *
+			nice_to_wmult[current_task->statistics.nice-NICE_MIN]) >> 32;
+	if (current_task->statistics.remaining_quantum > 0) --(current_task->statistics.remaining_quantum);
+	cfs_update_min_vruntime();
+}
+
+/* Fair scheduler check: slice consumed or a ready task is far enough behind */
+int sched_change_needed_CFS() {
+	struct task_struct * current_task = current();
+	struct task_struct * leftmost = cfs_leftmost();
+
+	if (leftmost == 0) return 0;
+	if (current_task == idle_task) return 1;
+	if (current_task->statistics.remaining_quantum == 0) return 1;
+	return vruntime_before(leftmost->statistics.vruntime + CFS_WAKEUP_GRANULARITY,
+						   current_task->statistics.vruntime);
+}
+
+/* Task switch fair scheduler. The slice is the task's share of CFS_LATENCY */
+void sched_switch_process_CFS() {
+	struct task_struct * task;
+	unsigned int slice;
+
+	task = cfs_leftmost();
+	if (task) {
+		cfs_dequeue(task);
+		slice = udiv(CFS_LATENCY*cfs_weight(task), cfs_load+cfs_weight(task));
+		task->statistics.remaining_quantum = slice < CFS_MIN_GRANULARITY ? CFS_MIN_GRANULARITY : slice;
+	}
+	else task = idle_task;
+
+	sched_task_switch(task);
+}
+
+/* Update queues state fair scheduler. A task waking up from a blocked state is placed
+ * at most half a latency period behind min_vruntime: it runs soon without being able
+ * to monopolize the CPU with the credit earned while sleeping. */
+void sched_update_queues_state_CFS(struct list_head* ls, struct task_struct * task) {
+	unsigned int floor;
+
+	if (ls != &readyqueue) {
+		sched_update_queues_state_RR(ls, task);
+		return;
+	}
+
+	if (task->process_state == ST_BLOCKED) {
+		floor = cfs_min_vruntime - (CFS_LATENCY*1000)/2;
+		if (vruntime_before(task->statistics.vruntime, floor)) task->statistics.vruntime = floor;
+	}
+
+	task->process_state = ST_READY;
+	sched_stats_ready(task);
+	if (task != idle_task) cfs_enqueue(task);
+}
+
+/* Changes the nice value of a task, updating the weight of the timeline if it is there */
+void sched_set_nice(struct task_struct * task, int nice) {
+#if SCHED_POLICY == SCHED_POLICY_CFS
+	if (task->process_state == ST_READY && task != idle_task && task->edf.period == 0) {
+		cfs_load -= cfs_weight(task);
+		task->statistics.nice = nice;
+		cfs_load += cfs_weight(task);
+		return;
+	}
+#endif
+	task->statistics.nice = nice;
+}
+
+/* MULTI-LEVEL FEEDBACK QUEUE */
+
+/* Quantum of a level */
+#define mlfq_quantum(level)	(MLFQ_BASE_QUANTUM<<(level))
+
+/* Highest level with ready tasks, -1 if there is none */
+static int mlfq_highest() {
+	int level;
+
+	for (level = 0; level < MLFQ_LEVELS; level++) {
+		if (!list_empty(&mlfq_queue[level])) return level;
+	}
+	return -1;
+}
+
+/* Priority boost: every ready task goes back to the top level. Blocked tasks notice
+ * the new boost count the next time they are queued. */
+static void mlfq_boost() {
+	struct list_head *pos, *n;
+	int level;
+
+	++mlfq_boosts;
+	for (level = 1; level < MLFQ_LEVELS; level++) {
+		list_for_each_safe(pos, n, &mlfq_queue[level]) {
+			struct task_struct * t = list_head_to_task_struct(pos);
+			list_del(pos);
+			t->statistics.level = 0;
+			t->statistics.remaining_quantum = 0;
+			t->mlfq_boost = mlfq_boosts;
+			list_add_tail(pos, &mlfq_queue[0]);
+		}
+	}
+}
+
+/* Initialize MLFQ scheduler */
+void init_Sched_MLFQ() {
+	int level;
+
+	sched_update_data = sched_update_data_MLFQ;
+	sched_change_needed = sched_change_needed_MLFQ;
+	sched_switch_process = sched_switch_process_MLFQ;
+	sched_update_queues_state = sched_update_queues_state_MLFQ;
+
+	for (level = 0; level < MLFQ_LEVELS; level++) INIT_LIST_HEAD(&mlfq_queue[level]);
+	mlfq_boosts = 0;
+	mlfq_boost_ticks = 0;
+
+	struct task_struct * current_task = current();
+	current_task->statistics.level = 0;
+	current_task->statistics.remaining_quantum = mlfq_quantum(0);
+	current_task->mlfq_boost = 0;
+	current_task->process_state = ST_READY;
+}
+
+/* Update MLFQ data: per level residency of the running task and the periodic boost */
+void sched_update_data_MLFQ() {
+	struct task_struct * current_task = current();
+
+	++(current_task->statistics.tics);
+	if (current_task != idle_task) {
+		++(current_task->statistics.level_tics[current_task->statistics.level]);
+		if (current_task->statistics.remaining_quantum > 0) --(current_task->statistics.remaining_quantum);
+	}
+
+	if (++mlfq_boost_ticks >= MLFQ_BOOST_PERIOD) {
+		mlfq_boost_ticks = 0;
+		mlfq_boost();
+		if (current_task != idle_task) {
+			current_task->statistics.level = 0;
+			current_task->mlfq_boost = mlfq_boosts;
+		}
+	}
+}
+
+/* MLFQ check: quantum consumed or a task is ready on a higher level */
+int sched_change_needed_MLFQ() {
+	struct task_struct * current_task = current();
+	int level = mlfq_highest();
+
+	if (level < 0) return 0;
+	if (current_task == idle_task) return 1;
+	if (current_task->statistics.remaining_quantum == 0) return 1;
+	return level < (int)current_task->statistics.level;
+}
+
+/* Task switch MLFQ: head of the highest non-empty level */
+void sched_switch_process_MLFQ() {
+	struct list_head *task_list;
+	struct task_struct * task;
+	int level;
+
+	level = mlfq_highest();
+	if (level >= 0) {
+		task_list = list_first(&mlfq_queue[level]);
+		list_del(task_list);
+		task = list_head_to_task_struct(task_list);
+		if (task->statistics.remaining_quantum == 0)
+			task->statistics.remaining_quantum = mlfq_quantum(level);
+	}
+	else task = idle_task;
+
+	sched_task_switch(task);
+}
+
+/* Update queues state MLFQ. The interactivity heuristic lives here: a task that has
+ * been blocked (keyboard, semaphore...) goes one level up, a task preempted after
+ * consuming its whole quantum goes one level down. A task preempted by a higher level
+ * keeps its level and the rest of its quantum. */
+void sched_update_queues_state_MLFQ(struct list_head* ls, struct task_struct * task) {
+	unsigned int level;
+
+	if (ls != &readyqueue) {
+		sched_update_queues_state_RR(ls, task);
+		return;
+	}
+
+	if (task == idle_task) {
+		task->process_state = ST_READY;
+		return;
+	}
+
+	level = task->statistics.level;
+	if (task->mlfq_boost != mlfq_boosts) {
+		task->mlfq_boost = mlfq_boosts;
+		level = 0;
+		task->statistics.remaining_quantum = 0;
+	}
+	else if (task->process_state == ST_BLOCKED) {
+		if (level > 0) --level;
+		task->statistics.remaining_quantum = 0;
+	}
+	else if (task->statistics.remaining_quantum == 0) {
+		if (level < MLFQ_LEVELS-1) ++level;
+	}
+
+	task->statistics.level = level;
+	task->process_state = ST_READY;
+	sched_stats_ready(task);
+	list_add_tail(&task->list, &mlfq_queue[level]);
+}
+
+/* EARLIEST DEADLINE FIRST */
+
+/* Starts the next job of a real-time task */
+static void edf_new_job(struct task_struct * task) {
+	task->edf.abs_deadline = task->edf.release + task->edf.deadline;
+	task->edf.budget = task->edf.runtime;
+	task->edf.release += task->edf.period;
+	task->edf.job_done = 0;
+	task->edf.job_missed = 0;
+}
+
+/* Counts deadline misses and releases the jobs whose period has started */
+static void edf_release_jobs() {
+	struct list_head *pos, *n;
+	unsigned int now = clock_get_time();
+
+	list_for_each(pos, &edf_tasks) {
+		struct task_struct * t = list_entry(pos, struct task_struct, edf.rt_list);
+		if (!t->edf.job_done && !t->edf.job_missed && time_after_eq(now, t->edf.abs_deadline)) {
+			t->edf.job_missed = 1;
+			++(t->statistics.deadline_misses);
+		}
+	}
+
+	list_for_each_safe(pos, n, &edf_periodqueue) {
+		struct task_struct * t = list_head_to_task_struct(pos);
+		if (time_after_eq(now, t->edf.release)) {
+			list_del(pos);
+			edf_new_job(t);
+			sched_update_queues_state(&readyqueue, t);
+		}
+	}
+}
+
+/* Initialize the EDF class above the current policy */
+void init_Sched_EDF() {
+	edf_next_update_data = sched_update_data;
+	edf_next_change_needed = sched_change_needed;
+	edf_next_switch_process = sched_switch_process;
+	edf_next_update_queues_state = sched_update_queues_state;
+
+	sched_update_data = sched_update_data_EDF;
+	sched_change_needed = sched_change_needed_EDF;
+	sched_switch_process = sched_switch_process_EDF;
+	sched_update_queues_state = sched_update_queues_state_EDF;
+
+	INIT_LIST_HEAD(&edf_readyqueue);
+	INIT_LIST_HEAD(&edf_periodqueue);
+	INIT_LIST_HEAD(&edf_tasks);
+	edf_utilization = 0;
+}
+
+/* Update EDF data: releases jobs, consumes the budget of a running real-time task */
+void sched_update_data_EDF() {
+	struct task_struct * current_task = current();
+
+	edf_release_jobs();
+
+	if (current_task->edf.period != 0) {
+		++(current_task->statistics.tics);
+		if (current_task->edf.budget > 0) --(current_task->edf.budget);
+	}
+	else edf_next_update_data();
+}
+
+/* EDF check: budget exhausted or a job with an earlier deadline is ready */
+int sched_change_needed_EDF() {
+	struct task_struct * current_task = current();
+	struct task_struct * first;
+
+	if (current_task->edf.period != 0) {
+		if (current_task->edf.budget == 0) return 1;
+		if (list_empty(&edf_readyqueue)) return 0;
+		first = list_head_to_task_struct(list_first(&edf_readyqueue));
+		return !time_after_eq(first->edf.abs_deadline, current_task->edf.abs_deadline);
+	}
+
+	if (!list_empty(&edf_readyqueue)) return 1;
+	return edf_next_change_needed();
+}
+
+/* Task switch EDF: the earliest deadline runs, without real-time jobs the policy below decides */
+void sched_switch_process_EDF() {
+	struct list_head *task_list;
+
+	if (list_empty(&edf_readyqueue)) {
+		edf_next_switch_process();
+		return;
+	}
+
+	task_list = list_first(&edf_readyqueue);
+	list_del(task_list);
+	sched_task_switch(list_head_to_task_struct(task_list));
+}
+
+/* Update queues state EDF. A ready real-time task is inserted by deadline; if its
+ * budget is exhausted it is throttled until its next release instead. */
+void sched_update_queues_state_EDF(struct list_head* ls, struct task_struct * task) {
+	struct list_head *pos;
+
+	if (ls != &readyqueue || task->edf.period == 0) {
+		edf_next_update_queues_state(ls, task);
+		return;
 	}
+
+	if (task->edf.budget == 0) {
+		edf_next_update_queues_state(&edf_periodqueue, task);
+		return;
+	}
+
+	task->process_state = ST_READY;
+	sched_stats_ready(task);
+	list_for_each(pos, &edf_readyqueue) {
+		if (!time_after_eq(task->edf.abs_deadline, list_head_to_task_struct(pos)->edf.abs_deadline)) break;
+	}
+	list_add_tail(&task->list, pos);
+}
+
+/* Declares the real-time parameters of a task. Admission control keeps the total density
+ * (runtime/deadline) of the real-time tasks under EDF_MAX_UTILIZATION. The first job is
+ * released now. period == 0 turns the task back into a normal one. */
+int sched_set_deadline(struct task_struct * task, unsigned int period, unsigned int runtime,
+					   unsigned int deadline) {
+	unsigned int old_util = 0, new_util;
+
+	if (task->edf.period != 0) old_util = udiv(task->edf.runtime*1000, task->edf.deadline);
+
+	if (period == 0) {
+		if (task->edf.period != 0) {
+			list_del(&task->edf.rt_list);
+			edf_utilization -= old_util;
+			task->edf.period = 0;
+		}
+		return 0;
+	}
+
+	if (runtime == 0 || runtime > deadline || deadline > period) return -EINVAL;
+
+	new_util = udiv(runtime*1000, deadline);
+	if (edf_utilization - old_util + new_util > EDF_MAX_UTILIZATION) return -ENOSCH;
+
+	if (task->edf.period == 0) list_add_tail(&task->edf.rt_list, &edf_tasks);
+	edf_utilization = edf_utilization - old_util + new_util;
+
+	task->edf.period = period;
+	task->edf.runtime = runtime;
+	task->edf.deadline = deadline;
+	task->edf.release = clock_get_time();
+	edf_new_job(task);
+
+	return 0;
+}
+
+/* Ends the current job. A late task starts its next job right away, otherwise it
+ * sleeps in edf_periodqueue until the timer interrupt releases it. */
+int sched_wait_period() {
+	struct task_struct * current_task = current();
+
+	if (current_task->edf.period == 0) return -EINVAL;
+
+	current_task->edf.job_done = 1;
+	if (time_after_eq(clock_get_time(), current_task->edf.release)) {
+		edf_new_job(current_task);
+		return 0;
+	}
+
+	sched_update_queues_state(&edf_periodqueue, current_task);
+	sched_switch_process();
+	return 0;
 }
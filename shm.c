@@ -0,0 +1,173 @@
+#include <shm.h>
+#include <errno.h>
+#include <mm.h>
+#include <mm_address.h>
+#include <sched.h>
+
+/* A shared memory region. It lives until it is removed (shm_remove) and no address
+ * space has it attached, the frames are freed then. */
+struct shm_region {
+	int used;
+	int removed; /* shm_remove done, it can not be attached again */
+	unsigned int npages;
+	unsigned int frames[SHM_MAX_PAGES];
+	int attaches; /* Address spaces where it is attached */
+};
+
+static struct shm_region shm_regions[SHM_SIZE];
+
+/* First page where each address space (directory) has attached each region, 0 if it
+ * is not attached */
+static unsigned int shm_attached[NR_TASKS][SHM_SIZE];
+
+static unsigned int * shm_attached_of(struct task_struct *t) {
+	return shm_attached[dir_index(get_DIR(t))];
+}
+
+/* Drops the reference of the region to its frames */
+static void shm_destroy(struct shm_region *r) {
+	int i;
+
+	for (i = 0; i < r->npages; i++) free_frame(r->frames[i]);
+	r->used = 0;
+}
+
+/* Unmaps the region 'id' from the address space of 't', the last detach of a removed
+ * region destroys it. Only the pages still mapped to the frames of the region are
+ * removed (munmap). */
+static void shm_unmap(struct task_struct *t, int id) {
+	struct shm_region * r = &shm_regions[id];
+	sl_page_table_entry * pt = get_PT(t,1);
+	unsigned int * attached = shm_attached_of(t);
+	int i;
+
+	for (i = 0; i < r->npages; i++) {
+		if (!check_used_page(&pt[attached[id]+i])) continue;
+		if (get_frame(pt, attached[id]+i) != r->frames[i]) continue;
+		free_frame(r->frames[i]);
+		del_ss_pag(pt, attached[id]+i);
+	}
+	attached[id] = 0;
+
+	if (--r->attaches == 0 && r->removed) shm_destroy(r);
+}
+
+/* Syscall shm_create, region 'id' of 'size' bytes filled with zeros */
+int sys_shm_create(int id, unsigned int size) {
+	struct shm_region * r;
+	unsigned int * page;
+	int i, j, frame;
+
+	if (id < 0 || id >= SHM_SIZE) return -EINVAL;
+	if (size == 0 || size > SHM_MAX_PAGES*PAGE_SIZE) return -EINVAL;
+	r = &shm_regions[id];
+	if (r->used) return -EEXIST;
+
+	r->npages = (size + PAGE_SIZE - 1) >> OFFSET_BITS;
+	for (i = 0; i < r->npages; i++) {
+		frame = alloc_frame();
+		if (frame == -1) {
+			while (i != 0) free_frame(r->frames[--i]); // rollback
+			return -ENMPHP;
+		}
+		page = kmap(frame);
+		for (j = 0; j < PAGE_SIZE/sizeof(unsigned int); j++) page[j] = 0;
+		r->frames[i] = frame;
+	}
+	r->attaches = 0;
+	r->removed = 0;
+	r->used = 1;
+	return 0;
+}
+
+/* Syscall shm_attach, maps the frames of the region 'id' in the mmap region of the
+ * task. Returns the address. */
+void *sys_shm_attach(int id) {
+	struct task_struct * current_pcb = current();
+	sl_page_table_entry * pt_current = get_PT(current_pcb,1);
+	unsigned int * attached = shm_attached_of(current_pcb);
+	struct shm_region * r;
+	int i, first;
+
+	if (id < 0 || id >= SHM_SIZE) return (void *)-EINVAL;
+	r = &shm_regions[id];
+	if (!r->used || r->removed) return (void *)-ENOENT;
+	if (attached[id] != 0) return (void *)-EEXIST;
+
+	first = mmap_region_alloc(pt_current, r->npages);
+	if (first < 0) return (void *)first;
+
+	for (i = 0; i < r->npages; i++) {
+		ref_frame(r->frames[i]);
+		set_ss_pag(pt_current, first + i, r->frames[i]);
+	}
+	attached[id] = first;
+	++r->attaches;
+	return (void *)((0x100+first)<<OFFSET_BITS);
+}
+
+/* Syscall shm_detach, 'addr' is the address returned by shm_attach */
+int sys_shm_detach(void *addr) {
+	struct task_struct * current_pcb = current();
+	unsigned int * attached = shm_attached_of(current_pcb);
+	unsigned int start = (unsigned int)addr;
+	int id;
+
+	if (OFFSET(start) != 0 || DIR(start) != 1) return -EINVAL;
+
+	for (id = 0; id < SHM_SIZE; id++) {
+		if (attached[id] != 0 && attached[id] == PAGE(start)) {
+			shm_unmap(current_pcb, id);
+			mmu_flush_tlb(get_DIR(current_pcb));
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+/* Syscall shm_remove, the region 'id' is destroyed now if it is not attached, otherwise
+ * on its last detach. The id can not be created again until then. */
+int sys_shm_remove(int id) {
+	struct shm_region * r;
+
+	if (id < 0 || id >= SHM_SIZE) return -EINVAL;
+	r = &shm_regions[id];
+	if (!r->used || r->removed) return -ENOENT;
+
+	r->removed = 1;
+	if (r->attaches == 0) shm_destroy(r);
+	return 0;
+}
+
+/* The child of a fork has the regions of the parent attached at the same addresses
+ * (its page table entries are already copied) */
+void shm_fork(struct task_struct *parent, struct task_struct *child) {
+	unsigned int * attached = shm_attached_of(parent);
+	unsigned int * child_attached = shm_attached_of(child);
+	int id;
+
+	for (id = 0; id < SHM_SIZE; id++) {
+		child_attached[id] = attached[id];
+		if (attached[id] != 0) ++shm_regions[id].attaches;
+	}
+}
+
+/* Detaches all the regions of an address space that goes away */
+void shm_release(struct task_struct *t) {
+	unsigned int * attached = shm_attached_of(t);
+	int id;
+
+	for (id = 0; id < SHM_SIZE; id++) {
+		if (attached[id] != 0) shm_unmap(t, id);
+	}
+}
+
+/* No regions, nothing attached */
+void init_shm() {
+	int i, id;
+
+	for (id = 0; id < SHM_SIZE; id++) shm_regions[id].used = 0;
+	for (i = 0; i < NR_TASKS; i++) {
+		for (id = 0; id < SHM_SIZE; id++) shm_attached[i][id] = 0;
+	}
+}
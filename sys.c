@@ -1,16 +1,20 @@
-#include <cbuffer.h>
 #include <devices.h>
 #include <errno.h>
 #include <interrupt.h>
 #include <io.h>
 #include <mm.h>
 #include <mm_address.h>
+#include <mman.h>
+#include <pipe.h>
+#include <pollwait.h>
 #include <sched.h>
 #include <sem.h>
 #include <stats.h>
 #include <system.h>
+#include <termios.h>
 #include <timer.h>
 #include <utils.h>
+#include <workqueue.h>
 #include <gpio.h>
 
 #define LECTURA 0
@@ -19,9 +23,11 @@
 /* Check read/write fd function */
 int check_fd(int fd, int permissions)
 {
-  if (fd != 1 && fd != 0) return -EBADF;
-  if (fd == 1 && permissions!=ESCRIPTURA) return -EACCES;
-  if (fd == 0 && permissions!=LECTURA) return -EACCES;
+  struct file * f = file_get(current(), fd);
+
+  if (f == NULL) return -EBADF;
+  if (permissions == ESCRIPTURA && !file_writable(f)) return -EACCES;
+  if (permissions == LECTURA && !file_readable(f)) return -EACCES;
   return 0;
 }
 
@@ -37,7 +43,7 @@ int sys_getpid() {
 
 /* Syscall clone, thread creation */
 int sys_clone(void (*function)(void), void *stack, unsigned int last_sp) {
-	int PID;
+	int PID, i;
 	unsigned int pos_sp = 0;
 
 	/* Variables initialization, get new task_struct from freequeue */
@@ -50,6 +56,7 @@ int sys_clone(void (*function)(void), void *stack, unsigned int last_sp) {
 	pos_sp = ((unsigned int)last_sp-(unsigned int)current_pcb)/4;
 
 	/* Copy of the stack and increment of the references to the directory/heap */
+	vfp_flush(current_pcb);
 	copy_data(current_pcb, new_pcb, 4096);
 	*(new_pcb->dir_count) += 1;
 	*(new_pcb->pb_count) += 1;
@@ -66,8 +73,13 @@ int sys_clone(void (*function)(void), void *stack, unsigned int last_sp) {
 	new_pcb->process_state = ST_READY;
 	new_pcb->statistics.tics = 0;
 	new_pcb->statistics.cs = 0;
-	PID = getNewPID();
-	new_pcb->PID = PID;
+	new_pcb->statistics.deadline_misses = 0;
+	for (i = 0; i < MLFQ_LEVELS; i++) new_pcb->statistics.level_tics[i] = 0;
+	new_pcb->edf.period = 0; /* Real-time parameters are not inherited */
+	init_sched_hist(new_pcb);
+	files_dup(new_pcb);
+	ipc_init(new_pcb);
+	PID = getNewPID(new_pcb);
 
 	/* Push to readyqueue to be scheduled */
 	sched_update_queues_state(&readyqueue,new_pcb);
@@ -98,7 +110,7 @@ int sys_DEBUG_tswitch() {
 int sys_fork(unsigned int last_sp) {
 	int PID;
 	unsigned int pos_sp = 0; // sp position relatively from the stack
-	int pag, pb;
+	int pag, pb, i;
 	int new_ph_pag;
 	int frames[NUM_PAG_DATA];
 
@@ -122,6 +134,7 @@ int sys_fork(unsigned int last_sp) {
 	}
 
 	/* Copy of the stack and get directory for the child */
+	vfp_flush(current_pcb);
 	copy_data(current_pcb, new_pcb, 4096);
 	allocate_page_dir(new_pcb);
 
@@ -134,6 +147,7 @@ int sys_fork(unsigned int last_sp) {
 	for (pag=0;pag<NUM_PAG_CODE;pag++) {
 		pt_usr_new[pag].entry = pt_usr_current[pag].entry;
 	}
+	dcache_clean_range(pt_usr_new, NUM_PAG_CODE*sizeof(sl_page_table_entry));
 
 	/* DATA */
 	for (pag=0;pag<NUM_PAG_DATA;pag++) {
@@ -150,7 +164,7 @@ int sys_fork(unsigned int last_sp) {
 				if (pag > 0) {
 					free_pag = PROC_FIRST_FREE_PAG_D1;
 					--pag;
-					mmu_change_dir(dir_current);
+					mmu_flush_tlb(dir_current);
 				}
 				else return -ENEPTE;
 			}
@@ -164,7 +178,7 @@ int sys_fork(unsigned int last_sp) {
 	}
 
 	/* TLB flush */
-	mmu_change_dir(dir_current);
+	mmu_flush_tlb(dir_current);
 
 	/* Copy Heap data */
 	get_newpb(new_pcb);
@@ -179,7 +193,7 @@ int sys_fork(unsigned int last_sp) {
 			if (pag > USR_P_HEAPSTART) {
 				free_pag = PAGE(pb+(1<<OFFSET_BITS));
 				--pag;
-				mmu_change_dir(dir_current);
+				mmu_flush_tlb(dir_current);
 			}
 			else return -ENEPTE;
 		}
@@ -203,7 +217,15 @@ int sys_fork(unsigned int last_sp) {
 	}
 
 	/* TLB flush */
-	mmu_change_dir(dir_current);
+	mmu_flush_tlb(dir_current);
+
+	/* File and shared memory mappings, the child shares their frames */
+	for (pag=MMAP_FIRST_PAG_D1; pag<IORING_FIRST_PAG_D1; pag++) {
+		pt_usr_new[pag].entry = pt_usr_current[pag].entry;
+		if (check_used_page(&pt_usr_new[pag])) ref_frame(pt_usr_new[pag].bits.pbase_addr);
+	}
+	dcache_clean_range(&pt_usr_new[MMAP_FIRST_PAG_D1], NUM_PAG_MMAP*sizeof(sl_page_table_entry));
+	shm_fork(current_pcb, new_pcb);
 
 	/* Setting the returning state */
 	new_pcb->kernel_sp = (unsigned int)&new_stack->stack[pos_sp];
@@ -215,8 +237,13 @@ int sys_fork(unsigned int last_sp) {
 	new_pcb->process_state = ST_READY;
 	new_pcb->statistics.tics = 0;
 	new_pcb->statistics.cs = 0;
-	PID = getNewPID();
-	new_pcb->PID = PID;
+	new_pcb->statistics.deadline_misses = 0;
+	for (i = 0; i < MLFQ_LEVELS; i++) new_pcb->statistics.level_tics[i] = 0;
+	new_pcb->edf.period = 0; /* Real-time parameters are not inherited */
+	init_sched_hist(new_pcb);
+	files_dup(new_pcb);
+	ipc_init(new_pcb);
+	PID = getNewPID(new_pcb);
 
 	/* Push to readyqueue to be scheduled */
 	sched_update_queues_state(&readyqueue,new_pcb);
@@ -237,14 +264,25 @@ void sys_exit() {
 	struct task_struct * current_pcb = current();
 	sl_page_table_entry * pt_current = get_PT(current_pcb,1);
 
-	/* Free DATA & HEAP region */
+	/* Free HEAP and mappings, the frames still mapped by other tasks are kept */
 	if (*(current_pcb->dir_count) == 1) {
+		shm_release(current_pcb);
 		for (pag=PROC_FIRST_FREE_PAG_D1;pag<TOTAL_PAGES_ENTRIES ;pag++){
+			if (!check_used_page(&pt_current[pag])) continue;
 			free_frame(pt_current[pag].bits.pbase_addr);
+			del_ss_pag(pt_current, pag);
 		}
 	}
 	*(current_pcb->dir_count) -= 1;
 	*(current_pcb->pb_count) -= 1;
+	pid_hash_del(current_pcb);
+	vfp_release(current_pcb);
+	io_release(current_pcb);
+	files_close(current_pcb);
+	ipc_release(current_pcb);
+
+	/* Release the CPU reserved by a real-time task */
+	sched_set_deadline(current_pcb, 0, 0, 0);
 
 	sched_update_queues_state(&freequeue,current());
 	sched_switch_process();
@@ -252,7 +290,7 @@ void sys_exit() {
 
 /* Syscall write */
 int sys_write(int fd, char * buffer, int size) {
-	char buff[4];
+	struct file * f;
 	int ret = 0;
 
 	ret = check_fd(fd,ESCRIPTURA);
@@ -261,20 +299,14 @@ int sys_write(int fd, char * buffer, int size) {
 	if (size <= 0) 		return -ESIZEB;
 	if (access_ok(VERIFY_READ, buffer, size) == 0) return -ENACCB;
 
-	while (size > 4) {
-		copy_from_user(buffer, buff, 4);
-		ret += sys_write_uart(buff,4);
-		buffer += 4;
-		size -= 4;
-	}
-	copy_from_user(buffer, buff, size);
-	ret += sys_write_uart(buff,size);
-
-	return ret;
+	/* No bounce buffer, the driver copies from the user pages */
+	f = current()->fds[fd];
+	return f->ops->write(f,buffer,size);
 }
 
 /* Syscall read */
 int sys_read(int fd, char * buffer, int size) {
+	struct file * f;
 	int ret = 0;
 
 	ret = check_fd(fd,LECTURA);
@@ -283,9 +315,43 @@ int sys_read(int fd, char * buffer, int size) {
 	if (size <= 0) 		return -ESIZEB;
 	if (access_ok(VERIFY_WRITE, buffer, size) == 0) return -ENACCB;
 
-	ret = sys_read_uart(buffer,size);
+	f = current()->fds[fd];
+	return f->ops->read(f,buffer,size);
+}
 
-	return ret;
+/* The descriptor 'fd' is open on the uart */
+static int is_tty(int fd) {
+	struct file * f = file_get(current(), fd);
+
+	return f != NULL && f->ops == &uart_fops;
+}
+
+/* Syscall tcgetattr, line discipline of the uart */
+int sys_tcgetattr(int fd, struct termios *t) {
+	struct termios kt;
+
+	if (!is_tty(fd)) return -EBADF;
+	if (t == NULL) return -EPNULL;
+	if (access_ok(VERIFY_WRITE, t, sizeof(struct termios)) == 0) return -ENACCB;
+
+	tty_get_termios(&kt);
+	copy_to_user(&kt, t, sizeof(struct termios));
+	return 0;
+}
+
+/* Syscall tcsetattr, changes the line discipline of the uart (only TCSANOW) */
+int sys_tcsetattr(int fd, int actions, struct termios *t) {
+	struct termios kt;
+
+	if (!is_tty(fd)) return -EBADF;
+	if (actions != TCSANOW) return -EINVAL;
+	if (t == NULL) return -EPNULL;
+	if (access_ok(VERIFY_READ, t, sizeof(struct termios)) == 0) return -ENACCB;
+
+	copy_from_user(t, &kt, sizeof(struct termios));
+	if (kt.c_lflag & ~(ICANON|ECHO)) return -EINVAL;
+	tty_set_termios(&kt);
+	return 0;
 }
 
 /* Syscall led */
@@ -299,18 +365,144 @@ unsigned int sys_gettime() {
 	return clock_get_time();
 }
 
+/* The timer of a sleeping process expired */
+static void sleep_timeout(struct ktimer *t) {
+	struct task_struct * task = t->data;
+
+	list_del(&task->list);
+	sched_update_queues_state(&readyqueue, task);
+}
+
+/* Blocks the current process in the sleepqueue until the tick 'expires' */
+static void sleep_until(unsigned int expires) {
+	struct task_struct * current_pcb = current();
+
+	init_ktimer(&current_pcb->sleep_timer, sleep_timeout, current_pcb);
+	ktimer_add(&current_pcb->sleep_timer, expires);
+	sched_update_queues_state(&sleepqueue, current_pcb);
+	sched_switch_process();
+}
+
+/* Syscall sleep_ms, blocks the process at least 'ms' milliseconds (1 tick == 1 ms) */
+int sys_sleep_ms(unsigned int ms) {
+	if (ms >= 0x80000000) return -EINVAL;
+	if (ms == 0) return 0;
+
+	/* The current tick has already started */
+	sleep_until(clock_get_time() + ms + 1);
+	return 0;
+}
+
+/* Syscall sleep_until, blocks the process until the clock (gettime) reaches 'deadline'.
+ * Periodic loops do not drift: the deadline does not depend on when the call is made. */
+int sys_sleep_until(unsigned int deadline) {
+	if (time_after_eq(clock_get_time(), deadline)) return 0;
+
+	sleep_until(deadline);
+	return 0;
+}
+
 /* Syscall get_stats */
 int sys_get_stats(int pid, struct stats *st) {
 	struct task_struct * desired;
-	int found;
 
-	if (access_ok(VERIFY_WRITE,st,12) == 0) return -ENACCB;
+	if (access_ok(VERIFY_WRITE,st,sizeof(struct stats)) == 0) return -ENACCB;
+
+	desired = find_task_by_pid(pid);
+	if (desired == NULL) return -ENSPID;
+
+	copy_to_user(&desired->statistics,st,sizeof(struct stats));
+	return 0;
+}
+
+/* Syscall get_stats_v, the structure filled depends on the version requested */
+int sys_get_stats_v(int pid, unsigned int version, void *st) {
+	struct task_struct * desired;
+	struct stats_v2 *st2 = st;
+
+	if ((desired = find_task_by_pid(pid)) == NULL) return -ENSPID;
+
+	switch (version) {
+	case STATS_V1:
+		if (access_ok(VERIFY_WRITE,st,sizeof(struct stats)) == 0) return -ENACCB;
+		copy_to_user(&desired->statistics,st,sizeof(struct stats));
+		break;
+	case STATS_V2:
+		if (access_ok(VERIFY_WRITE,st,sizeof(struct stats_v2)) == 0) return -ENACCB;
+		copy_to_user(&desired->statistics,&st2->st,sizeof(struct stats));
+		copy_to_user(&desired->hist,&st2->hist,sizeof(struct sched_hist));
+		break;
+	default:
+		return -EINVAL;
+	}
+	return 0;
+}
+
+/* Syscall get_work_stats, execution times of the deferred work item 'id' */
+int sys_get_work_stats(int id, struct work_stats *st) {
+	struct work_struct * work;
+
+	if (access_ok(VERIFY_WRITE,st,sizeof(struct work_stats)) == 0) return -ENACCB;
+	if ((work = get_work(id)) == NULL) return -EINVAL;
+
+	copy_to_user(&work->stats,st,sizeof(struct work_stats));
+	return 0;
+}
+
+/* Syscall set_priority, changes the priority of the process with the especified PID */
+int sys_set_priority(int pid, int prio) {
+	struct task_struct * desired;
+
+	if (prio < 0 || prio >= NR_PRIO) return -EINVAL;
+	if ((desired = find_task_by_pid(pid)) == NULL) return -ENSPID;
+
+	sched_set_priority(desired, prio);
+	return 0;
+}
+
+/* Syscall set_nice, changes the weight of the process with the especified PID */
+int sys_set_nice(int pid, int nice) {
+	struct task_struct * desired;
 
-	found = getStructPID(pid, &readyqueue, &desired);
-	if (!found) found = getStructPID(pid, &keyboardqueue, &desired);
-	if (found) copy_to_user(&desired->statistics,st,12);
+	if (nice < NICE_MIN || nice > NICE_MAX) return -EINVAL;
+	if ((desired = find_task_by_pid(pid)) == NULL) return -ENSPID;
 
-	else return -ENSPID;
+	sched_set_nice(desired, nice);
+	return 0;
+}
+
+/* Syscall set_deadline, makes the current process a periodic real-time task (EDF).
+ * All the parameters are in ticks, period == 0 makes it a normal task again */
+int sys_set_deadline(unsigned int period, unsigned int runtime, unsigned int deadline) {
+	return sched_set_deadline(current(), period, runtime, deadline);
+}
+
+/* Syscall wait_period, ends the current job and blocks until the next release */
+int sys_wait_period() {
+	return sched_wait_period();
+}
+
+/* Syscall get_sys_stats, system wide counters */
+int sys_get_sys_stats(struct sys_stats *st) {
+	struct sys_stats kst;
+
+	if (access_ok(VERIFY_WRITE,st,sizeof(struct sys_stats)) == 0) return -ENACCB;
+
+	kst.suppressed_ticks = suppressed_ticks;
+	kst.vfp_switches = vfp_switches;
+	kst.tlb_flushes_avoided = tlb_flushes_avoided;
+	kst.asid_rollovers = asid_rollovers;
+	kst.uart_rx_bytes = uart_rx_bytes;
+	kst.uart_rx_overruns = uart_rx_overruns;
+	kst.uart_rx_fifo_overruns = uart_rx_fifo_overruns;
+	kst.uart_tx_bytes = uart_tx_bytes;
+	kst.uart_tx_irqs = uart_tx_irqs;
+	kst.uart_tx_stalls = uart_tx_stalls;
+	kst.pipe_bytes = pipe_bytes;
+	kst.pipe_pages_moved = pipe_pages_moved;
+	kst.pipe_read_blocks = pipe_read_blocks;
+	kst.pipe_write_blocks = pipe_write_blocks;
+	copy_to_user(&kst,st,sizeof(struct sys_stats));
 	return 0;
 }
 
@@ -356,7 +548,10 @@ int sys_sem_signal(int n_sem) {
 	if (n_sem < 0 || n_sem >= SEM_SIZE) return -EINVSN;
 	if (sem_array[n_sem].pid_owner == -1) return -ENINIT;
 
-	if(list_empty(&sem_array[n_sem].semqueue)) sem_array[n_sem].value++;
+	if(list_empty(&sem_array[n_sem].semqueue)) {
+		sem_array[n_sem].value++;
+		poll_wake(&sem_array[n_sem].pollers);
+	}
 	else {
 		struct list_head *task_list = list_first(&sem_array[n_sem].semqueue);
 		list_del(task_list);
@@ -367,6 +562,15 @@ int sys_sem_signal(int n_sem) {
 	return ret;
 }
 
+/* Readiness of a semaphore for poll: POLLIN if sem_wait would not block */
+short sem_poll(int n_sem, short events, struct poll_table *pt) {
+	if (sem_array[n_sem].pid_owner == -1) return POLLNVAL;
+
+	poll_wait(pt, &sem_array[n_sem].pollers);
+	if ((events & POLLIN) && sem_array[n_sem].value > 0) return POLLIN;
+	return 0;
+}
+
 /* Syscall semaphore destroy, destroy n_sem semaphore */
 int sys_sem_destroy(int n_sem) {
 	int ret = 0;
@@ -376,6 +580,7 @@ int sys_sem_destroy(int n_sem) {
 
 	if (current()->PID == sem_array[n_sem].pid_owner) {
 		sem_array[n_sem].pid_owner = -1;
+		poll_wake(&sem_array[n_sem].pollers);
 		while (!list_empty(&sem_array[n_sem].semqueue)) {
 			struct list_head *task_list = list_first(&sem_array[n_sem].semqueue);
 			list_del(task_list);
@@ -400,7 +605,7 @@ void *sys_sbrk(int increment) {
 	if (increment > 0) {
 		int end = ((pb+increment)>>OFFSET_BITS)-(1<<PAGE_BITS);
 
-		if (end < TOTAL_PAGES_ENTRIES) { /* Lower limit of the HEAP */
+		if (end < MMAP_FIRST_PAG_D1) { /* Lower limit of the HEAP, the file mappings are above */
 			for(i = PAGE(pb); i < end || ( i==end && (0!=OFFSET((pb+increment))) ); ++i) {
 				if (!check_used_page(&pt_current[i])) {
 					int new_ph_pag=alloc_frame();
@@ -419,7 +624,7 @@ void *sys_sbrk(int increment) {
 				free_frame(pt_current[i].bits.pbase_addr);
 				del_ss_pag(pt_current, i);
 			}
-			mmu_change_dir(dir_current);
+			mmu_flush_tlb(dir_current);
 		}
 		else return (void *)-EHLIMI;
 	}
@@ -429,5 +634,68 @@ void *sys_sbrk(int increment) {
 	return ret;
 }
 
+/* Syscall mmap, maps 'length' bytes of the file 'fd' from 'offset' (a multiple of
+ * PAGE_SIZE) at the first free pages of the mmap region. The pages are the frames of
+ * the file: they are shared with every mapping and with read/write. Returns the address. */
+void *sys_mmap(unsigned int length, int prot, int fd, unsigned int offset) {
+	struct task_struct * current_pcb = current();
+	sl_page_table_entry * pt_current = get_PT(current_pcb,1);
+	struct file * f = file_get(current_pcb, fd);
+	unsigned int npages, i;
+	int first, frame;
+
+	if (f == NULL) return (void *)-EBADF;
+	if (f->ops->mmap == NULL) return (void *)-EINVAL;
+	if (prot == 0 || (prot & ~(PROT_READ|PROT_WRITE))) return (void *)-EINVAL;
+	if (length == 0 || OFFSET(offset) != 0) return (void *)-EINVAL;
+	if ((prot & PROT_READ) && !file_readable(f)) return (void *)-EACCES;
+	if ((prot & PROT_WRITE) && !file_writable(f)) return (void *)-EACCES;
+	if (length > NUM_PAG_MMAP*PAGE_SIZE) return (void *)-ENOMEM;
+	npages = (length + PAGE_SIZE - 1) >> OFFSET_BITS;
+
+	first = mmap_region_alloc(pt_current, npages);
+	if (first < 0) return (void *)first;
+
+	for (i = 0; i < npages; i++) {
+		frame = f->ops->mmap(f, (offset >> OFFSET_BITS) + i);
+		if (frame < 0) {
+			while (i != 0) { // rollback
+				--i;
+				free_frame(get_frame(pt_current, first + i));
+				del_ss_pag(pt_current, first + i);
+			}
+			mmu_flush_tlb(get_DIR(current_pcb));
+			return (void *)frame;
+		}
+		/* The file keeps its own reference */
+		ref_frame(frame);
+		if (prot & PROT_WRITE) set_ss_pag(pt_current, first + i, frame);
+		else set_ss_pag_ro(pt_current, first + i, frame);
+	}
+
+	return (void *)((0x100+first)<<OFFSET_BITS);
+}
+
+/* Syscall munmap, removes the file mappings of the pages of [addr, addr+length) */
+int sys_munmap(void *addr, unsigned int length) {
+	struct task_struct * current_pcb = current();
+	sl_page_table_entry * pt_current = get_PT(current_pcb,1);
+	unsigned int start = (unsigned int)addr;
+	int pag, last;
+
+	if (OFFSET(start) != 0 || length == 0 || DIR(start) != 1) return -EINVAL;
+	if (length > NUM_PAG_MMAP*PAGE_SIZE) return -EINVAL;
+	last = PAGE(start) + ((length + PAGE_SIZE - 1) >> OFFSET_BITS);
+	if (PAGE(start) < MMAP_FIRST_PAG_D1 || last > IORING_FIRST_PAG_D1) return -EINVAL;
+
+	for (pag = PAGE(start); pag < last; pag++) {
+		if (!check_used_page(&pt_current[pag])) continue;
+		free_frame(get_frame(pt_current, pag));
+		del_ss_pag(pt_current, pag);
+	}
+	mmu_flush_tlb(get_DIR(current_pcb));
+	return 0;
+}
+
 
 
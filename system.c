@@ -1,16 +1,24 @@
+#include <devices.h>
 #include <hardware.h>
 #include <interrupt.h>
 #include <io.h>
 #include <mm.h>
+#include <pipe.h>
+#include <ramfs.h>
 #include <sched.h>
 #include <system.h>
 #include <timer.h>
 #include <uart.h>
+#include <vfp.h>
+#include <workqueue.h>
 #include <utils.h>
 
 int (*usr_main)(void) = (void *) PH_USER_START;
+/* Initialized statically, printk can be used before 'main' sets anything up */
 char uart_read_buff_arr[UART_READ_BUFFER_SIZE];
-Circular_Buffer uart_read_buffer;
+struct ring uart_read_buffer = RING_INIT(uart_read_buff_arr, 1, UART_READ_BUFFER_SIZE);
+char uart_write_buff_arr[UART_WRITE_BUFFER_SIZE];
+struct ring uart_write_buffer = RING_INIT(uart_write_buff_arr, 1, UART_WRITE_BUFFER_SIZE);
 Sem sem_array[SEM_SIZE];
 
 /* Pointers to the size of the system and user blocks specified at build/link time */
@@ -35,6 +43,9 @@ int __attribute__((__section__(".text.main"))) main() {
 	/* Initialize exception vector base */
 	set_exception_base();
 
+	/* Enable the VFP coprocessor */
+	init_vfp();
+
 	/* Initialize Memory */
 	init_mm();
 
@@ -42,6 +53,7 @@ int __attribute__((__section__(".text.main"))) main() {
 	init_gpio();
 	init_uart();
 	init_timer();
+	init_tty();
 
 	printk("Kernel Loaded!\n");
 
@@ -49,17 +61,27 @@ int __attribute__((__section__(".text.main"))) main() {
 	init_freequeue();
 	init_readyqueue();
 	init_keyboardqueue();
+	init_sleepqueue();
+	init_pidhash();
 	init_semarray();
 
 	init_sched();
 	init_idle();
 	init_task1();
 
-	circularbInit(&uart_read_buffer,uart_read_buff_arr, UART_READ_BUFFER_SIZE);
+	/* Kernel threads for the deferred work */
+	init_workqueues();
+	init_ioring();
+	init_ramfs();
+	init_pipes();
+	init_shm();
+	init_futex();
+
 	set_interruptions();
 
 	/* Move user code/data now (after the page table initialization) */
 	copy_data((void *) KERNEL_START + *p_sys_size, usr_main, *p_usr_size);
+	sync_code_range(usr_main, *p_usr_size);
 
 	printk("Entering user mode...\n");
 
@@ -2,13 +2,39 @@
 #include <mm.h>
 
 volatile unsigned int clock_time;
+union time_page_union time_page __attribute__((__section__(".data.time_page")));
+
+/* Timer wheel: tv1 has a slot per tick, tvn[l] slots of 2^(8+6*l) ticks that are cascaded
+ * down when tv1 wraps. wheel_time is the next tick to be processed. */
+static struct list_head tv1[TVR_SIZE];
+static struct list_head tvn[TVN_LEVELS][TVN_SIZE];
+static unsigned int wheel_time;
+static unsigned int ktimers_pending;
+
+#define TVN_INDEX(l)	((wheel_time >> (TVR_BITS+(l)*TVN_BITS)) & TVN_MASK)
+
+static void init_timer_wheel();
+
+/* Tickless idle: ticks programmed when the tick was stopped (0 == periodic tick running),
+ * counts already elapsed in the tick the timer was stopped and value loaded */
+static unsigned int tick_stopped;
+static unsigned int tick_phase;
+static unsigned int tick_load;
+unsigned int suppressed_ticks;
 
 /* Initialize peripheral timer */
 void init_timer() {
 	set_vitual_to_phsycial(TIMER_BASE,TIMER_BASE_PH,0);
+	set_user_ro_page(STIMER_BASE,STIMER_BASE_PH,1);
+	set_user_ro_page(TIME_PAGE_ADDR,(unsigned int)&time_page,0);
 
 	clock_time = 0;
-	timer_set_initial_time(1000); // 1ms == 1 int
+	time_page.tp.clock = 0;
+	time_page.tp.pid = 0;
+	tick_stopped = 0;
+	suppressed_ticks = 0;
+	init_timer_wheel();
+	timer_set_initial_time(TIMER_TICK); // 1ms == 1 int
 	set_address_to(TIMER_CNTL, 0xF900A2);
 }
 
@@ -22,11 +48,185 @@ void timer_set_initial_time(unsigned int time) {
 	set_address_to(TIMER_LOAD, time);
 }
 
+/* Microseconds from the free-running system timer, wraps around every ~71 minutes */
+unsigned int timer_get_us() {
+	return get_value_from(STIMER_CLO);
+}
+
+/* Stops the periodic tick (IRQs disabled): the next timer interrupt arrives 'ticks'
+ * ticks later, at a tick boundary, and then the timer is periodic again. */
+void tick_stop(unsigned int ticks) {
+	unsigned int value;
+
+	if (ticks > TICKLESS_MAX_TICKS) ticks = TICKLESS_MAX_TICKS;
+	if (ticks <= 1 || tick_stopped) return;
+	if (get_value_from(TIMER_RAQ_IRQ)&0x1) return; // a tick is already pending
+
+	value = get_value_from(TIMER_VALUE);
+	tick_phase = TIMER_TICK - value;
+	tick_load = value + (ticks-1)*TIMER_TICK;
+	set_address_to(TIMER_LOAD, tick_load);
+	set_address_to(TIMER_RELOAD, TIMER_TICK);
+	tick_stopped = ticks;
+}
+
+/* Restarts the periodic tick after an idle period and makes the clock catch up.
+ * Returns the ticks that were suppressed. */
+unsigned int tick_restart() {
+	unsigned int counts, elapsed;
+
+	if (!tick_stopped) return 0;
+
+	if (get_value_from(TIMER_RAQ_IRQ)&0x1) {
+		/* Full period: the pending timer interrupt accounts the last tick */
+		elapsed = tick_stopped-1;
+	}
+	else {
+		/* Woken up by another interrupt: next tick at the next tick boundary */
+		counts = tick_phase + tick_load - get_value_from(TIMER_VALUE);
+		elapsed = counts/TIMER_TICK;
+		set_address_to(TIMER_LOAD, TIMER_TICK - counts%TIMER_TICK);
+	}
+
+	tick_stopped = 0;
+	clock_time += elapsed;
+	time_page.tp.clock = clock_time;
+	suppressed_ticks += elapsed;
+	return elapsed;
+}
+
+///////////// Timer wheel /////////////
+
+/* Initialize the timer wheel, empty */
+static void init_timer_wheel() {
+	int i, l;
+
+	for (i = 0; i < TVR_SIZE; i++) INIT_LIST_HEAD(&tv1[i]);
+	for (l = 0; l < TVN_LEVELS; l++) {
+		for (i = 0; i < TVN_SIZE; i++) INIT_LIST_HEAD(&tvn[l][i]);
+	}
+	wheel_time = clock_time;
+	ktimers_pending = 0;
+}
+
+/* Puts the timer in the slot of its expiration time */
+static void internal_add(struct ktimer *t) {
+	unsigned int expires = t->expires;
+	unsigned int idx = expires - wheel_time;
+	int l;
+
+	if ((int)idx < 0) {
+		/* Already expired: next tick */
+		list_add_tail(&t->list, &tv1[wheel_time & TVR_MASK]);
+	}
+	else if (idx < TVR_SIZE) {
+		list_add_tail(&t->list, &tv1[expires & TVR_MASK]);
+	}
+	else {
+		/* Beyond the wheel: last slot, it will be cascaded again */
+		if (idx >= TV_MAX_TICKS) expires = wheel_time + TV_MAX_TICKS - 1;
+		for (l = 0; l < TVN_LEVELS-1 && (expires - wheel_time) >= (1u<<(TVR_BITS+(l+1)*TVN_BITS)); l++);
+		list_add_tail(&t->list, &tvn[l][(expires >> (TVR_BITS+l*TVN_BITS)) & TVN_MASK]);
+	}
+}
+
+/* Moves the timers of a slot of level 'l' to the lower levels. Returns the index of the slot,
+ * when it is 0 the level above has to be cascaded too */
+static int cascade(int l, int index) {
+	struct list_head *pos, *n;
+	struct list_head slot;
+
+	/* Detach the slot first, a timer can not go back to it */
+	INIT_LIST_HEAD(&slot);
+	if (!list_empty(&tvn[l][index])) {
+		slot.next = tvn[l][index].next;
+		slot.prev = tvn[l][index].prev;
+		slot.next->prev = &slot;
+		slot.prev->next = &slot;
+		INIT_LIST_HEAD(&tvn[l][index]);
+	}
+
+	list_for_each_safe(pos, n, &slot) {
+		list_del(pos);
+		internal_add(list_entry(pos, struct ktimer, list));
+	}
+	return index;
+}
+
+/* Runs the timers expired up to the current tick. Every tick costs O(1), the cascades
+ * (every 256 ticks) move each timer at most once per level. */
+static void run_timers() {
+	struct list_head *slot;
+	struct ktimer *t;
+	unsigned int index;
+
+	while (time_after_eq(clock_time, wheel_time)) {
+		index = wheel_time & TVR_MASK;
+		if (!index && !cascade(0, TVN_INDEX(0)) && !cascade(1, TVN_INDEX(1))) cascade(2, TVN_INDEX(2));
+		++wheel_time;
+
+		slot = &tv1[index];
+		while (!list_empty(slot)) {
+			t = list_entry(list_first(slot), struct ktimer, list);
+			list_del(&t->list);
+			--ktimers_pending;
+			t->function(t);
+		}
+	}
+}
+
+/* Initialize a kernel timer, not pending */
+void init_ktimer(struct ktimer *t, void (*function)(struct ktimer *t), void * data) {
+	t->list.next = NULL;
+	t->function = function;
+	t->data = data;
+}
+
+/* Arms the timer to expire at tick 'expires' (IRQs disabled) */
+void ktimer_add(struct ktimer *t, unsigned int expires) {
+	if (ktimer_pending(t)) ktimer_del(t);
+	t->expires = expires;
+	internal_add(t);
+	++ktimers_pending;
+}
+
+/* Disarms the timer */
+void ktimer_del(struct ktimer *t) {
+	if (!ktimer_pending(t)) return;
+	list_del(&t->list);
+	--ktimers_pending;
+}
+
+/* Returns 1 if the timer is armed */
+int ktimer_pending(struct ktimer *t) {
+	return t->list.next != NULL;
+}
+
+/* Ticks until the next timer expiration, for the tickless idle. Timers of the upper levels
+ * are only known to come down when tv1 wraps, that cascade counts as an event. */
+unsigned int timer_next_event() {
+	unsigned int i, index;
+	int ticks;
+
+	if (ktimers_pending == 0) return TICKLESS_MAX_TICKS;
+
+	for (i = 0; i < TVR_SIZE; i++) {
+		index = (wheel_time + i) & TVR_MASK;
+		if (!list_empty(&tv1[index]) || index == 0) break;
+	}
+
+	/* The slot of wheel_time+i is processed at that tick */
+	ticks = (int)(wheel_time + i - clock_time);
+	return ticks > 0 ? ticks : 1;
+}
+
 ///////////// Clock /////////////
 
-/* Increase tick clock */
+/* Increase tick clock and runs the expired timers */
 void clock_increase() {
 	clock_time++;
+	time_page.tp.clock = clock_time;
+	run_timers();
 }
 
 /* return clock value*/
@@ -37,4 +237,5 @@ unsigned int clock_get_time() {
 /* set clock value */
 void clock_set_time(unsigned long time) {
 	clock_time = time;
+	time_page.tp.clock = clock_time;
 }
@@ -56,14 +56,29 @@ Byte uart_interrupt_pend_tx() {
 	return ((get_value_from(AUX_MU_IIR_REG)&0b110) == 0b10);
 }
 
+/* Uart enable/disable the tx empty interrupt */
+void uart_toggle_tx_interrupt(unsigned char enable) {
+	unsigned int reg = get_value_from(AUX_MU_IER_REG);
+
+	if (enable) reg = reg|0b10;
+	else reg = reg&(~0b10);
+
+	set_address_to(AUX_MU_IER_REG, reg);
+}
+
 /* Check uart tx ready */
 Byte uart_tx_ready() {
 	return (get_value_from(AUX_MU_LSR_REG)>>5)&0x1;
 }
 
+/* Uart line status (AUX_MU_LSR_* bits) */
+Byte uart_line_status() {
+	return get_value_from(AUX_MU_LSR_REG);
+}
+
 /* Check uart data available */
 Byte uart_data_available() {
-	return get_value_from(AUX_MU_LSR_REG)&0x1;
+	return uart_line_status()&AUX_MU_LSR_DATA_READY;
 }
 
 /* Uart send byte */
@@ -72,6 +87,11 @@ void uart_send_byte(Byte c) {
 	set_address_to(AUX_MU_IO_REG,c);
 }
 
+/* Uart put byte, the tx fifo must have room (uart_tx_ready) */
+void uart_put_byte(Byte c) {
+	set_address_to(AUX_MU_IO_REG,c);
+}
+
 /* Uart recive byte */
 Byte uart_get_byte() {
 	while (!uart_data_available());
@@ -128,8 +128,89 @@ void semaphores_test1() {
 }
 
 
+void periodic_test() {
+	char cbuff[11];
+	struct stats st;
+	int job;
+
+	/* 10 ticks period, 2 ticks of CPU per job, deadline at the end of the period */
+	if (set_deadline(10, 2, 10) == -1) perror("set_deadline");
+	for (job = 0; job < 1000; job++) {
+		/* sample */
+		wait_period();
+	}
+	get_stats(getpid(), &st);
+	write(1,"Deadline misses: ",17);
+	itoa(st.deadline_misses,cbuff);write(1,cbuff,strlen(cbuff));write(1,"\n",1);
+	set_deadline(0, 0, 0);
+	while(1);
+}
+
+#define IPC_ROUNDS 1000
+
+/* Echo server: answers each request with its first word incremented */
+void ipc_server() {
+	struct ipc_msg msg;
+	int client = -1;
+
+	while (1) {
+		client = ipc_reply_wait(client, &msg);
+		if (client == -1) perror("ipc_reply_wait");
+		msg.w[0]++;
+	}
+}
+
+/* Semaphore ping-pong server: sem 0 is the request, sem 1 the reply */
+void sem_server() {
+	while (1) {
+		sem_wait(0);
+		sem_signal(1);
+	}
+}
+
+void print_round_trip(char *name, unsigned int us) {
+	char cbuff[11];
+
+	write(1,name,strlen(name));
+	itoa(us,cbuff);write(1,cbuff,strlen(cbuff));
+	write(1," us/1000 round trips\n",21);
+}
+
+/* Round trip latency of ipc_call/ipc_reply_wait against two semaphores */
+void ipc_benchmark() {
+	struct ipc_msg msg;
+	unsigned int start;
+	int server, i;
+
+	server = fork();
+	if (server == 0) ipc_server();
+
+	msg.w[0] = 0;
+	start = gettime_us();
+	for (i = 0; i < IPC_ROUNDS; i++) {
+		if (ipc_call(server, &msg) == -1) perror("ipc_call");
+	}
+	print_round_trip("ipc_call: ", gettime_us() - start);
+	if (msg.w[0] != IPC_ROUNDS) write(1,"ipc_call: wrong replies\n",24);
+
+	sem_init(0,0);
+	sem_init(1,0);
+	if (fork() == 0) sem_server();
+
+	start = gettime_us();
+	for (i = 0; i < IPC_ROUNDS; i++) {
+		sem_signal(0);
+		sem_wait(1);
+	}
+	print_round_trip("semaphores: ", gettime_us() - start);
+	while(1);
+}
+
+
 int __attribute__ ((__section__(".text.main"))) main() {
 
+	//ipc_benchmark();
+	//periodic_test();
 	//dinam_test2();
 	semaphores_test1();
 
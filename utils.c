@@ -102,3 +102,24 @@ void delay() {
 }
 
 
+
+/* Unsigned division (0 if 'd' is 0). ARMv6 has no divide instruction and the kernel
+ * is not linked with libgcc (__aeabi_uidiv). */
+unsigned int udiv(unsigned int n, unsigned int d) {
+	unsigned int q = 0, bit = 1;
+
+	if (d == 0) return 0;
+	while (d <= n && !(d & 0x80000000)) {
+		d <<= 1;
+		bit <<= 1;
+	}
+	while (bit) {
+		if (n >= d) {
+			n -= d;
+			q |= bit;
+		}
+		d >>= 1;
+		bit >>= 1;
+	}
+	return q;
+}
@@ -0,0 +1,112 @@
+#include <vfp.h>
+#include <sched.h>
+
+/* The VFP registers are switched lazily: on a task switch the VFP is only disabled,
+ * the first VFP instruction of the new task traps (undefined instruction) and then
+ * the registers of the previous owner are saved and the ones of the task loaded.
+ * The kernel is compiled soft float (Makefile), so it never touches the user VFP state. */
+
+struct task_struct * vfp_owner;
+unsigned int vfp_switches;
+
+/* fmrx/fmxr of the VFP system registers, coded as cp10 accesses */
+#define fmrx_fpexc(v)	__asm__ __volatile__ ("mrc p10, 7, %0, cr8, cr0, 0;" : "=r"(v))
+#define fmxr_fpexc(v)	__asm__ __volatile__ ("mcr p10, 7, %0, cr8, cr0, 0;" : : "r"(v))
+
+/* Save the VFP registers (fstmiad d0-d15 + fmrx fpscr) */
+static void vfp_save(struct vfp_state * st) {
+	__asm__ __volatile__ (
+		"stc p11, cr0, [%1], {32};"
+		"mrc p10, 7, %0, cr1, cr0, 0;"
+		: "=r"(st->fpscr)
+		: "r"(st->s)
+		: "memory"
+	);
+}
+
+/* Load the VFP registers (fldmiad d0-d15 + fmxr fpscr) */
+static void vfp_load(struct vfp_state * st) {
+	__asm__ __volatile__ (
+		"ldc p11, cr0, [%1], {32};"
+		"mcr p10, 7, %0, cr1, cr0, 0;"
+		:
+		: "r"(st->fpscr), "r"(st->s)
+		: "memory"
+	);
+}
+
+/* Grants access to cp10/cp11 and leaves the VFP disabled until a task uses it */
+void init_vfp() {
+	unsigned int cpacr;
+
+	__asm__ __volatile__ ("mrc p15, 0, %0, c1, c0, 2;" : "=r"(cpacr));
+	cpacr |= CPACR_VFP_FULL;
+	__asm__ __volatile__ (
+		"mcr p15, 0, %0, c1, c0, 2;"
+		"mcr p15, 0, %1, c7, c5, 4;" // flush prefetch buffer
+		:
+		: "r"(cpacr), "r"(0)
+	);
+	fmxr_fpexc(0);
+
+	vfp_owner = NULL;
+	vfp_switches = 0;
+}
+
+/* Initial VFP state of a task: zeroed registers, RunFast mode */
+void vfp_init_state(struct vfp_state * st) {
+	int i;
+
+	for (i = 0; i < VFP_SREGS; i++) st->s[i] = 0;
+	st->fpscr = FPSCR_DEFAULT;
+}
+
+/* Called on every task switch: the VFP stays enabled only if the next task owns it */
+void vfp_task_switch(struct task_struct * next) {
+	fmxr_fpexc(next == vfp_owner ? FPEXC_EN : 0);
+}
+
+/* Undefined instruction trap. Returns 1 if it was the first VFP instruction of the
+ * current task since it got the CPU: the VFP is given to the task and the instruction
+ * has to be executed again. Returns 0 for any other undefined instruction. */
+int vfp_trap(unsigned int instr) {
+	struct task_struct * t = current();
+	unsigned int fpexc;
+
+	/* cp10/cp11 CDP, MCR/MRC, LDC/STC, MCRR/MRRC */
+	if (((instr>>8)&0xE) != 0xA) return 0;
+	if (((instr>>24)&0xF) != 0xE && ((instr>>25)&0x7) != 0x6) return 0;
+
+	/* Already enabled: a bounced instruction, there is no support code for it */
+	fmrx_fpexc(fpexc);
+	if (fpexc&(FPEXC_EN|FPEXC_EX)) return 0;
+
+	fmxr_fpexc(FPEXC_EN);
+	if (vfp_owner != t) {
+		if (vfp_owner != NULL) vfp_save(&vfp_owner->vfp);
+		vfp_load(&t->vfp);
+		vfp_owner = t;
+		++vfp_switches;
+	}
+	return 1;
+}
+
+/* Writes back the VFP registers of the task to its task_struct (before copying it) */
+void vfp_flush(struct task_struct * t) {
+	unsigned int fpexc;
+
+	if (vfp_owner != t) return;
+
+	fmrx_fpexc(fpexc);
+	fmxr_fpexc(FPEXC_EN);
+	vfp_save(&t->vfp);
+	fmxr_fpexc(fpexc);
+}
+
+/* The task dies, its task_struct must not keep owning the VFP registers */
+void vfp_release(struct task_struct * t) {
+	if (vfp_owner == t) {
+		vfp_owner = NULL;
+		fmxr_fpexc(0);
+	}
+}
@@ -0,0 +1,104 @@
+#include <workqueue.h>
+#include <errno.h>
+#include <sched.h>
+#include <timer.h>
+
+struct workqueue system_wq;
+
+/* Works registered, for the statistics */
+static struct work_struct * works[NR_WORKS];
+static int nr_works;
+
+/* Initializes a work item and registers it for the statistics (if there is room) */
+void init_work(struct work_struct *work, char *name, void (*func)(struct work_struct *work)) {
+	int i;
+
+	work->func = func;
+	work->pending = 0;
+	for (i = 0; i < WORK_NAME_LEN-1 && name[i] != '\0'; i++) work->stats.name[i] = name[i];
+	work->stats.name[i] = '\0';
+	work->stats.runs = 0;
+	work->stats.total_us = 0;
+	work->stats.max_us = 0;
+	work->stats.last_us = 0;
+	work->stats.max_delay_us = 0;
+
+	if (nr_works < NR_WORKS) works[nr_works++] = work;
+}
+
+/* Registered work with the given id, NULL if there is none */
+struct work_struct * get_work(int id) {
+	if (id < 0 || id >= nr_works) return NULL;
+	return works[id];
+}
+
+/* Kernel thread of a workqueue. Runs the works queued with IRQs enabled and
+ * sleeps while there are none. The queue is only touched with IRQs disabled. */
+static void worker_thread(void * arg) {
+	struct workqueue * wq = arg;
+	struct work_struct * work;
+	unsigned int start, elapsed;
+
+	while (1) {
+		if (list_empty(&wq->works)) {
+			sched_update_queues_state(&wq->idle, current());
+			sched_switch_process();
+			continue;
+		}
+
+		work = list_entry(list_first(&wq->works), struct work_struct, list);
+		list_del(&work->list);
+		work->pending = 0;
+
+		start = timer_get_us();
+		if (start - work->queued_us > work->stats.max_delay_us) work->stats.max_delay_us = start - work->queued_us;
+
+		__asm__ __volatile__ ("cpsie i;");
+		work->func(work);
+		__asm__ __volatile__ ("cpsid i;");
+
+		elapsed = timer_get_us() - start;
+		++(work->stats.runs);
+		work->stats.total_us += elapsed;
+		work->stats.last_us = elapsed;
+		if (elapsed > work->stats.max_us) work->stats.max_us = elapsed;
+	}
+}
+
+/* Creates the kernel thread of a workqueue */
+int init_workqueue(struct workqueue *wq) {
+	INIT_LIST_HEAD(&wq->works);
+	INIT_LIST_HEAD(&wq->idle);
+
+	wq->worker = kthread_create(worker_thread, wq);
+	if (wq->worker == NULL) return -ENTASK;
+	return 0;
+}
+
+/* Queues a work (IRQs disabled, it can be called from an interrupt handler).
+ * Returns 0 if it was already pending, 1 otherwise. */
+int queue_work(struct workqueue *wq, struct work_struct *work) {
+	if (work->pending) return 0;
+
+	work->pending = 1;
+	work->queued_us = timer_get_us();
+	list_add_tail(&work->list, &wq->works);
+
+	/* Wake up the worker */
+	if (!list_empty(&wq->idle)) {
+		list_del(&wq->worker->list);
+		sched_update_queues_state(&readyqueue, wq->worker);
+	}
+	return 1;
+}
+
+/* Queues a work on the system workqueue */
+int schedule_work(struct work_struct *work) {
+	return queue_work(&system_wq, work);
+}
+
+/* Initializes the system workqueue */
+void init_workqueues() {
+	nr_works = 0;
+	init_workqueue(&system_wq);
+}